@@ -0,0 +1,163 @@
+#ifndef GGML_BITNET_BANDWIDTH_H
+#define GGML_BITNET_BANDWIDTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Memory-bandwidth governor
+ *
+ * Decode streams every weight once per token, so a fully threaded process
+ * saturates the DRAM channels it shares with co-located services. The
+ * BitNet kernels charge the bytes they stream here, and the governor keeps
+ * the process under a GB/s budget in two ways:
+ * it paces the charging threads with a shared token bucket (GCRA, so any
+ * window longer than the burst stays within budget) and it tells the op
+ * layer how many threads are worth waking for the next matmul, given the
+ * bandwidth one thread achieves.
+ *
+ * Without a budget (the default) charging only counts bytes for the report.
+ * BITNET_BW_BUDGET_GBPS in the environment sets a budget at first use, and
+ * BITNET_BW_REPORT=1 prints the report at exit, so an unmodified host
+ * program can be capped.
+ *
+ * In ggml hosts (llama-cli, llama-server) only pacing applies: ggml sizes
+ * its thread pool from -t and never asks ggml_bitnet_bw_threads(), and the
+ * per-row kernels charge without timing, so there is no per-thread estimate.
+ * The kernel library (kernels/) times its tiles and trims its threads too.
+ * The per-row charges are skipped entirely while the governor is inactive.
+ *
+ * What is charged: the kernel library charges its weight tiles and output
+ * writes; the per-row ggml kernels (ggml_vec_dot_i2_i8_s and the cached
+ * STFMA path) charge their packed weight row only, through
+ * ggml_bitnet_bw_charge_weights(). Their int8 activation row is read once
+ * per row too but is reused from cache across the rows of a matmul, so the
+ * ggml figures are weights only and understate traffic when the activations
+ * do not fit in cache (large batches).
+ */
+
+/**
+ * @brief Governor modes (bit mask)
+ */
+#define GGML_BITNET_BW_PACE    1   // sleep charging threads until their bytes fit the budget
+#define GGML_BITNET_BW_THREADS 2   // run the next op on just enough threads to reach the budget
+
+/**
+ * @brief Bytes a thread accumulates before it is paced
+ *
+ * Per-row kernels charge a few hundred bytes at a time; batching keeps the
+ * shared bucket off their hot path.
+ */
+#define GGML_BITNET_BW_QUANTUM (64 * 1024)
+
+/**
+ * @brief Burst the bucket lets through before pacing starts, in nanoseconds
+ */
+#define GGML_BITNET_BW_BURST_NS 200000
+
+/**
+ * @brief Governor report
+ */
+struct ggml_bitnet_bw_stats {
+    double budget_gbps;         // 0 when no budget is set
+    int mode;                   // GGML_BITNET_BW_* mask
+    uint64_t bytes;             // bytes charged since the last reset
+    uint64_t weight_only_bytes; // of bytes, charged by the per-row ggml kernels (packed weights only)
+    uint64_t elapsed_ns;        // first to last charge
+    double achieved_gbps;       // bytes / elapsed_ns
+    uint64_t throttled_ns;      // time threads spent paced, summed over threads
+    uint64_t throttle_events;   // number of pacing sleeps
+    double thread_gbps;         // bandwidth one unthrottled thread achieves (moving average), 0 if unknown
+};
+
+/**
+ * @brief Nonzero while there is a budget or a report to feed
+ *
+ * Set by ggml_bitnet_bw_set_budget() and BITNET_BW_REPORT; read through
+ * ggml_bitnet_bw_active().
+ */
+extern int ggml_bitnet_bw_enabled;
+
+/**
+ * @brief Whether per-row kernels should charge at all
+ *
+ * A relaxed load, cheap enough to test on every row; without a budget or a
+ * report the charges would only be counted and never read.
+ */
+static inline int ggml_bitnet_bw_active(void) {
+    return __atomic_load_n(&ggml_bitnet_bw_enabled, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Set the budget
+ *
+ * @param gbps Budget in GB/s (1e9 bytes per second), 0 to disable
+ * @param mode GGML_BITNET_BW_PACE and/or GGML_BITNET_BW_THREADS
+ */
+void ggml_bitnet_bw_set_budget(double gbps, int mode);
+
+/**
+ * @brief Current budget in GB/s, 0 when disabled
+ */
+double ggml_bitnet_bw_budget(void);
+
+/**
+ * @brief Charge bytes streamed by the calling thread
+ *
+ * Accumulates per thread and, once GGML_BITNET_BW_QUANTUM bytes are
+ * pending, reserves them in the shared bucket and sleeps if the process is
+ * ahead of its budget.
+ *
+ * @param bytes Bytes read or written by the kernel
+ * @param busy_ns Time the kernel spent on them, or 0 if not measured;
+ *                feeds the per-thread bandwidth estimate
+ */
+void ggml_bitnet_bw_charge(size_t bytes, uint64_t busy_ns);
+
+/**
+ * @brief Charge the packed weight row of a per-row ggml kernel
+ *
+ * ggml_bitnet_bw_charge(bytes, 0), also counted in weight_only_bytes so the
+ * report can say which figures leave the activations out.
+ *
+ * @param bytes Packed weight bytes of the row
+ */
+void ggml_bitnet_bw_charge_weights(size_t bytes);
+
+/**
+ * @brief Threads to use for the next op
+ *
+ * With GGML_BITNET_BW_THREADS, the fewest threads whose combined
+ * unthrottled bandwidth reaches the budget; otherwise (or before the first
+ * measurement) nth.
+ *
+ * @param nth Threads available
+ * @return Threads to use, in [1, nth]
+ */
+int ggml_bitnet_bw_threads(int nth);
+
+/**
+ * @brief Read the report
+ */
+void ggml_bitnet_bw_get_stats(struct ggml_bitnet_bw_stats* stats);
+
+/**
+ * @brief Reset the byte and throttling counters (not the budget or the estimate)
+ */
+void ggml_bitnet_bw_reset_stats(void);
+
+/**
+ * @brief Print achieved versus budgeted bandwidth
+ */
+void ggml_bitnet_bw_print(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GGML_BITNET_BANDWIDTH_H
@@ -0,0 +1,221 @@
+#ifndef GGML_BITNET_FIXEDPOINT_H
+#define GGML_BITNET_FIXEDPOINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Integer-domain inter-layer pipeline
+ *
+ * Between consecutive BitNet linear layers the activations stay integers:
+ * int32 accumulators or int8 quantized rows, each with one per-token scale
+ * held as a normalized mantissa and exponent. Rescaling is an integer
+ * multiply-shift and the absmax requantization that feeds the next layer
+ * needs no float, because the int8 row is invariant to the scale of its
+ * input. The same holds for the sub-layer RMSNorm, so inside a BitNet FFN
+ * (gate/up -> ReLU^2 * up -> sub_norm -> down) floats only appear at the
+ * block input and output. Attention and the residual stream stay in float.
+ *
+ * Elementwise work is integer only; per-token scalars (one rms and one
+ * scale per row) may be evaluated in double.
+ */
+
+/**
+ * @brief Per-token scale: a real value is v * m * 2^(e - 31)
+ *
+ * m is normalized to [2^30, 2^31), or 0 for an all-zero row.
+ */
+struct ggml_bitnet_fx_scale {
+    int32_t m;
+    int32_t e;
+};
+
+/**
+ * @brief Convert a positive real scale (weight scale, float boundary)
+ */
+struct ggml_bitnet_fx_scale ggml_bitnet_fx_scale_from_float(double f);
+
+/**
+ * @brief Real value of a scale
+ */
+double ggml_bitnet_fx_scale_to_float(struct ggml_bitnet_fx_scale s);
+
+/**
+ * @brief Product of two scales (integer multiply-shift)
+ */
+struct ggml_bitnet_fx_scale ggml_bitnet_fx_scale_mul(struct ggml_bitnet_fx_scale a, struct ggml_bitnet_fx_scale b);
+
+/**
+ * @brief Quantize a float row to int8 (absmax to 127), entering the pipeline
+ *
+ * @param x Input row
+ * @param n Row length
+ * @param q Output int8 row
+ * @param s Output scale of q
+ * @return Sum of q, which the I2_S dot product needs to remove its +1 offset
+ */
+int32_t ggml_bitnet_fx_quantize_f32(const float* x, int n, int8_t* q, struct ggml_bitnet_fx_scale* s);
+
+/**
+ * @brief Quantize a float vector to int16 (absmax to 32767), for norm weights at load time
+ */
+void ggml_bitnet_fx_quantize_i16(const float* x, int n, int16_t* q, struct ggml_bitnet_fx_scale* s);
+
+/**
+ * @brief Requantize int32 accumulators to an int8 row without leaving the integer domain
+ *
+ * Same absmax rule as the float path: q = round(127 * acc / max|acc|).
+ *
+ * @param acc Accumulators
+ * @param n Row length
+ * @param s_acc Scale of acc
+ * @param q Output int8 row
+ * @param s_q Output scale of q
+ * @return Sum of q
+ */
+int32_t ggml_bitnet_fx_requantize_i32(const int32_t* acc, int n, struct ggml_bitnet_fx_scale s_acc,
+                                      int8_t* q, struct ggml_bitnet_fx_scale* s_q);
+
+/**
+ * @brief Leave the pipeline: y = acc * s_acc
+ */
+void ggml_bitnet_fx_dequantize_i32(const int32_t* acc, int n, struct ggml_bitnet_fx_scale s_acc, float* y);
+
+/**
+ * @brief Gated squared ReLU of the BitNet FFN: out = max(gate, 0)^2 * up
+ *
+ * Both inputs are reduced to 15 significant bits and the int64 product is
+ * shifted back to 30 bits; the shifts go into the output exponent.
+ */
+void ggml_bitnet_fx_relu2_mul_i32(const int32_t* gate, struct ggml_bitnet_fx_scale s_gate,
+                                  const int32_t* up, struct ggml_bitnet_fx_scale s_up,
+                                  int n, int32_t* out, struct ggml_bitnet_fx_scale* s_out);
+
+/**
+ * @brief RMSNorm in place: x = x / rms(x) * gamma
+ *
+ * @param x Row, overwritten with x * gamma at 30 bits
+ * @param n Row length
+ * @param s Scale of x, updated to the scale of the normalized row
+ * @param gamma Norm weight from ggml_bitnet_fx_quantize_i16()
+ * @param s_gamma Scale of gamma
+ * @param eps Norm epsilon (in real units)
+ */
+void ggml_bitnet_fx_rmsnorm_i32(int32_t* x, int n, struct ggml_bitnet_fx_scale* s,
+                                const int16_t* gamma, struct ggml_bitnet_fx_scale s_gamma, float eps);
+
+/**
+ * @brief Ternary matrix-vector product into int32 accumulators
+ *
+ * @param n Row length (multiple of 128)
+ * @param m Number of rows
+ * @param w I2_S weights, n / 4 bytes per row
+ * @param q Int8 input row
+ * @param q_sum Sum of q (returned by the quantize/requantize functions)
+ * @param acc Output, m accumulators of sum(w * q) with w in {-1, 0, 1}
+ */
+void ggml_bitnet_fx_mul_mat_i2_s(int n, int m, const uint8_t* w, const int8_t* q, int32_t q_sum, int32_t* acc);
+
+/**
+ * @brief Maximum number of layers in an error report
+ */
+#define GGML_BITNET_FX_MAX_LAYERS 16
+
+/**
+ * @brief Accumulated deviation of one layer from the float path
+ */
+struct ggml_bitnet_fx_layer_error {
+    char name[32];
+    uint64_t tokens;
+    double sum_err2;   // sum of (fixed - float)^2
+    double sum_ref2;   // sum of float^2
+    double max_abs;    // largest |fixed - float|
+};
+
+/**
+ * @brief Per-layer error report of the integer pipeline against the float path
+ */
+struct ggml_bitnet_fx_report {
+    int n_layers;
+    struct ggml_bitnet_fx_layer_error layers[GGML_BITNET_FX_MAX_LAYERS];
+};
+
+/**
+ * @brief Reset a report
+ */
+void ggml_bitnet_fx_report_reset(struct ggml_bitnet_fx_report* report);
+
+/**
+ * @brief Compare one token of a layer against its float reference
+ *
+ * @param report Report
+ * @param name Layer name; rows of the same name accumulate
+ * @param ref Float path output
+ * @param v Integer path output
+ * @param s Scale of v
+ * @param n Row length
+ */
+void ggml_bitnet_fx_report_add(struct ggml_bitnet_fx_report* report, const char* name,
+                               const float* ref, const int32_t* v, struct ggml_bitnet_fx_scale s, int n);
+
+/**
+ * @brief Relative RMS error of a layer, sqrt(sum_err2 / sum_ref2)
+ */
+double ggml_bitnet_fx_layer_rel_error(const struct ggml_bitnet_fx_layer_error* layer);
+
+/**
+ * @brief Print one line per layer: relative RMS error, SNR and max abs error
+ */
+void ggml_bitnet_fx_report_print(const struct ggml_bitnet_fx_report* report, FILE* out);
+
+/**
+ * @brief Weights of one BitNet FFN block (I2_S)
+ */
+struct ggml_bitnet_fx_ffn {
+    int n_embd;
+    int n_ff;
+    const uint8_t* gate;               // n_ff rows of n_embd
+    const uint8_t* up;                 // n_ff rows of n_embd
+    const uint8_t* down;               // n_embd rows of n_ff
+    struct ggml_bitnet_fx_scale s_gate;
+    struct ggml_bitnet_fx_scale s_up;
+    struct ggml_bitnet_fx_scale s_down;
+    const int16_t* sub_norm;           // ffn_sub_norm weight, from ggml_bitnet_fx_quantize_i16()
+    struct ggml_bitnet_fx_scale s_sub_norm;
+    const float* sub_norm_f32;         // original weight, only read for the error report
+    float eps;
+};
+
+/**
+ * @brief Scratch bytes needed by ggml_bitnet_fx_ffn_forward()
+ */
+size_t ggml_bitnet_fx_ffn_work_size(const struct ggml_bitnet_fx_ffn* ffn);
+
+/**
+ * @brief One token through a BitNet FFN block in the integer domain
+ *
+ * x (the ffn_norm output) is quantized once on entry and y is dequantized
+ * once on exit; everything in between is integer. When report is not NULL
+ * the float path (float dequantization after every matmul, float ReLU^2,
+ * sub_norm and requantization) runs alongside and each layer's deviation
+ * is accumulated into the report.
+ *
+ * @param ffn Block weights
+ * @param x Input row (n_embd)
+ * @param y Output row (n_embd)
+ * @param work Scratch of ggml_bitnet_fx_ffn_work_size() bytes
+ * @param report Optional error report
+ */
+void ggml_bitnet_fx_ffn_forward(const struct ggml_bitnet_fx_ffn* ffn, const float* x, float* y,
+                                void* work, struct ggml_bitnet_fx_report* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GGML_BITNET_FIXEDPOINT_H
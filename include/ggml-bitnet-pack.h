@@ -0,0 +1,146 @@
+#pragma once
+
+// Weight packers and reference dots shared by the kernels, the standalone
+// library, the self-test and the tests. Internal: header-only, no ggml
+// dependency, ternary weights as int8 values in {-1, 0, +1}.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GGML_BITNET_QK_I2_S 128
+
+// I2_S (quantize_i2_s): each block of 128 values is 32 bytes, value j at byte j % 32,
+// bits 6 - 2 * (j / 32), stored as w + 1
+static inline void ggml_bitnet_pack_i2_s(const int8_t * ternary, uint8_t * dst, size_t n) {
+    memset(dst, 0, n / 4);
+    for (size_t i = 0; i < n; i++) {
+        const size_t pos = i % GGML_BITNET_QK_I2_S;
+        dst[i / GGML_BITNET_QK_I2_S * 32 + pos % 32] |= (uint8_t)((ternary[i] + 1) << (6 - 2 * (pos / 32)));
+    }
+}
+
+static inline void ggml_bitnet_unpack_i2_s(const uint8_t * src, int8_t * ternary, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const size_t pos = i % GGML_BITNET_QK_I2_S;
+        ternary[i] = (int8_t)(((src[i / GGML_BITNET_QK_I2_S * 32 + pos % 32] >> (6 - 2 * (pos / 32))) & 3) - 1);
+    }
+}
+
+// STFMA: linear, value i at byte i / 4, bits 2 * (i % 4), encoded 0 -> 00, +1 -> 01, -1 -> 10
+static inline void ggml_bitnet_pack_stfma(const int8_t * ternary, uint8_t * dst, size_t n) {
+    memset(dst, 0, n / 4);
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t trit = ternary[i] > 0 ? 1 : (ternary[i] < 0 ? 2 : 0);
+        dst[i / 4] |= (uint8_t)(trit << (2 * (i % 4)));
+    }
+}
+
+// exact ternary dot, sum(w * y)
+static inline int32_t ggml_bitnet_ref_dot_ternary(const int8_t * w, const int8_t * y, size_t n) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += w[i] * y[i];
+    }
+    return sum;
+}
+
+// what ggml_vec_dot_i2_i8_s returns: the stored I2_S codes (w + 1) times y
+static inline int32_t ggml_bitnet_ref_vec_dot_i2_i8_s(const uint8_t * x, const int8_t * y, size_t n) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        const size_t pos = i % GGML_BITNET_QK_I2_S;
+        sum += ((x[i / GGML_BITNET_QK_I2_S * 32 + pos % 32] >> (6 - 2 * (pos / 32))) & 3) * y[i];
+    }
+    return sum;
+}
+
+// TL1/TL2 as the GGUF converter writes them (preprocess_weights_tl1/tl2), for the
+// tiling of one kernel_config section: BM rows per tile, BY columns per block, bm rows
+// per inner block. Each row of 32 bytes keeps its four 8-byte groups in this order.
+static inline int ggml_bitnet_tl_row_in_group(int p) {
+    static const int perm[4] = {0, 2, 1, 3};
+    return perm[p / 8] * 8 + p % 8;
+}
+
+// TL1: pairs (w0, w1) -> 3 * w0 + w1 + 4, two pairs per byte; M * K / 4 bytes
+static inline void ggml_bitnet_pack_tl1(const int8_t * ternary, int M, int K, int BM, int BY, int bm, uint8_t * dst) {
+    const int by = 256 / bm;
+    size_t o = 0;
+    for (int T = 0; T < M / BM; T++)
+    for (int kb = 0; kb < K / BY; kb++)
+    for (int rb = 0; rb < BM / bm; rb++)
+    for (int pb = 0; pb < BY / by; pb++)
+    for (int rq = 0; rq < bm / 16; rq++)
+    for (int pk = 0; pk < by / 4; pk++)
+    for (int rr = 0; rr < 16; rr++) {
+        const int r = T * BM + rb * bm + rq * 16 + rr;
+        const int p = kb * BY / 2 + pb * by / 2 + pk * 2;
+        const int8_t * row = ternary + (size_t)r * K;
+        const int hi = 3 * row[2 * p] + row[2 * p + 1] + 4;
+        const int lo = 3 * row[2 * p + 2] + row[2 * p + 3] + 4;
+        dst[o++] = (uint8_t)((hi << 4) + lo);
+    }
+}
+
+// TL2 splits K into three_k columns in triples and two_k tail columns in pairs
+static inline int ggml_bitnet_tl2_three_k(int K, int BY) {
+    return K / BY * BY;
+}
+
+static inline size_t ggml_bitnet_tl2_size(int M, int K, int BY) {
+    const int three_k = ggml_bitnet_tl2_three_k(K, BY), two_k = K - three_k;
+    return (size_t)M * three_k / 6 + (size_t)M * three_k / 24 + (size_t)M * two_k / 4;
+}
+
+// triple value 9 * w0 + 3 * w1 + w2 of row r, group g
+static inline int ggml_bitnet_tl2_triple(const int8_t * ternary, int K, int r, int g) {
+    const int8_t * v = ternary + (size_t)r * K + 3 * g;
+    return 9 * v[0] + 3 * v[1] + v[2];
+}
+
+// TL2: the triples as magnitude nibbles, then their sign bit plane, then the tail
+// columns in TL1 pairs, each tile of BM rows contiguous; ggml_bitnet_tl2_size() bytes.
+// codegen_tl2.py only generates bm = 32, whatever bmm a preset config lists.
+static inline void ggml_bitnet_pack_tl2(const int8_t * ternary, int M, int K, int BM, int BY, uint8_t * dst) {
+    const int bm = 32, by = 192 / bm;
+    const int three_k = ggml_bitnet_tl2_three_k(K, BY), two_k = K - three_k;
+
+    for (int T = 0; T < M / BM; T++)
+    for (int kb = 0; kb < three_k / BY; kb++)
+    for (int rb = 0; rb < BM / bm; rb++)
+    for (int gb = 0; gb < BY / by; gb++)
+    for (int p = 0; p < bm; p++) {
+        const int r = T * BM + rb * bm + ggml_bitnet_tl_row_in_group(p);
+        const int g = kb * BY / 3 + gb * by / 3;
+        *dst++ = (uint8_t)((abs(ggml_bitnet_tl2_triple(ternary, K, r, g)) << 4) + abs(ggml_bitnet_tl2_triple(ternary, K, r, g + 1)));
+    }
+
+    // sign bits: 16 per uint16, bit 15 - i for group i / 2 of row (i % 2) * 16 + j
+    for (int T = 0; T < M / BM; T++)
+    for (int kb = 0; kb < three_k / BY; kb++)
+    for (int rb = 0; rb < BM / bm; rb++)
+    for (int gq = 0; gq < BY / (by * 4); gq++)
+    for (int j = 0; j < bm / 2; j++) {
+        uint16_t bits = 0;
+        for (int i = 0; i < 16; i++) {
+            const int r = T * BM + rb * bm + (i % 2) * 16 + j;
+            const int g = kb * BY / 3 + gq * 8 + i / 2;
+            bits |= (uint16_t)((ggml_bitnet_tl2_triple(ternary, K, r, g) < 0) << (15 - i));
+        }
+        *dst++ = (uint8_t)(bits & 0xff);
+        *dst++ = (uint8_t)(bits >> 8);
+    }
+
+    // pairs of the tail columns, blocked by 32 with bm = 32, by = 4
+    for (int T = 0; T < M / BM; T++)
+    for (int kb = 0; kb < two_k / 32; kb++)
+    for (int rb = 0; rb < BM / 32; rb++)
+    for (int hb = 0; hb < 8; hb++)
+    for (int p = 0; p < 32; p++) {
+        const int r = T * BM + rb * 32 + ggml_bitnet_tl_row_in_group(p);
+        const int8_t * v = ternary + (size_t)r * K + three_k + 2 * (kb * 16 + hb * 2);
+        *dst++ = (uint8_t)(((3 * v[0] + v[1] + 4) << 4) + (3 * v[2] + v[3] + 4));
+    }
+}
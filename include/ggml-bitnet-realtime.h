@@ -0,0 +1,48 @@
+#ifndef GGML_BITNET_REALTIME_H
+#define GGML_BITNET_REALTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Low-jitter decode helpers
+ *
+ * Static work partitions and a monotonic clock, used by the standalone
+ * kernel library (kernels/), the bandwidth governor and the worker team.
+ *
+ * The low-jitter decode mode itself (run_inference.py --realtime) works at
+ * the process level: llama-server is pinned to a core set with one thread
+ * per core and runs with --mlock, and the wrapper reports the per-token
+ * latency histogram. The llama.cpp graph threads are not pinned one per core.
+ */
+
+/**
+ * @brief Static work partition for thread ith of nth
+ *
+ * Splits n rows into nth contiguous ranges whose boundaries are multiples of
+ * align (except the end of the last range). The split depends only on
+ * (ith, nth, n, align), so every token runs the same rows on the same thread.
+ *
+ * @param ith Thread index
+ * @param nth Number of threads
+ * @param n Number of rows
+ * @param align Row alignment of range boundaries (>= 1)
+ * @param start Output: first row (inclusive)
+ * @param end Output: last row (exclusive)
+ */
+void ggml_bitnet_rt_partition(int ith, int nth, int n, int align, int* start, int* end);
+
+/**
+ * @brief Monotonic clock in nanoseconds
+ */
+uint64_t ggml_bitnet_rt_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GGML_BITNET_REALTIME_H
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "ggml.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+// check outcome, the report status is the worst of all checks
+enum ggml_bitnet_health {
+    GGML_BITNET_HEALTH_PASS = 0,   // healthy
+    GGML_BITNET_HEALTH_WARN = 1,   // degraded: host configuration costs throughput or latency
+    GGML_BITNET_HEALTH_FAIL = 2,   // unhealthy: wrong results or kernels far below the expected speed
+};
+
+// Startup self-test: checks the host (ISA of the build vs the CPU, AVX-512 clock penalty,
+// transparent hugepages, NUMA placement) and runs short correctness and throughput probes
+// of the compiled kernels (MAD, STFMA, and the TL preprocessing and ggml_qgemm_lut on the
+// smallest generated shape). Throughput is measured against a scalar baseline on the same
+// host, so the expected ranges hold on any CPU of the target ISA.
+// Writes a JSON health report to out (may be NULL) and returns the overall status.
+GGML_API enum ggml_bitnet_health ggml_bitnet_selftest(FILE * out);
+
+#ifdef  __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+#ifndef GGML_BITNET_STFMA_AVX2_H
+#define GGML_BITNET_STFMA_AVX2_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Vectorized dense ternary FMA kernel (AVX2)
+ * 
+ * Processes 16 elements per iteration (two 8-lane int32 vectors per 32-bit
+ * word of packed trits). Trits are decoded with the same arithmetic as
+ * stfma_decode_trit(), and applied with a sign operation instead of a
+ * 32-bit multiply.
+ * 
+ * @param weights Pointer to STFMA-encoded ternary weights (2-bit packed, linear order)
+ * @param activations Pointer to int32 activations
+ * @param n Number of elements (any value, the tail is decoded with stfma_decode_trit)
+ * @return Dot product result
+ */
+int32_t ggml_bitnet_stfma_dense_avx2(
+    const uint8_t* weights,
+    const int32_t* activations,
+    size_t n
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GGML_BITNET_STFMA_AVX2_H
@@ -8,6 +8,11 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Number of elements in one I2_S block (128 weights packed into 32 bytes)
+ */
+#define GGML_BITNET_STFMA_CACHE_BLOCK 128
+
 /**
  * @brief Opaque handle to a cached weight tensor
  */
@@ -23,14 +28,15 @@ void ggml_bitnet_stfma_cache_init(void);
 /**
  * @brief Convert and cache a weight tensor at load time
  * 
- * @param bitnet_weights Pointer to BitNet 2-bit encoded weights
- * @param n Number of elements
+ * @param bitnet_weights Pointer to I2_S packed weights (BitNet encoding)
+ * @param n Number of elements (must be a multiple of GGML_BITNET_STFMA_CACHE_BLOCK)
  * @return Handle to cached weights, or NULL on failure
  * 
  * This function:
  * 1. Converts BitNet encoding to STFMA encoding (branchless)
- * 2. Allocates persistent memory for the converted weights
- * 3. Returns a handle that can be used during inference
+ * 2. Repacks the I2_S block layout into linear order (element i in byte i/4)
+ * 3. Allocates persistent memory for the converted weights
+ * 4. Returns a handle that can be used during inference
  * 
  * The conversion happens ONCE at load time, not per-inference.
  */
@@ -39,6 +45,23 @@ ggml_bitnet_stfma_cache_handle ggml_bitnet_stfma_cache_weights(
     size_t n
 );
 
+/**
+ * @brief Convert I2_S packed weights to linear STFMA-encoded weights
+ * 
+ * I2_S stores element j of each 128-element block in byte j % 32 at bit
+ * 6 - 2 * (j / 32). The output stores element i in byte i / 4 at bit
+ * 2 * (i % 4), which is the layout all STFMA dense kernels expect.
+ * 
+ * @param bitnet_weights Pointer to I2_S packed weights (BitNet encoding)
+ * @param stfma_weights Output buffer of n / 4 bytes
+ * @param n Number of elements (must be a multiple of GGML_BITNET_STFMA_CACHE_BLOCK)
+ */
+void ggml_bitnet_stfma_repack_i2_s(
+    const uint8_t* bitnet_weights,
+    uint8_t* stfma_weights,
+    size_t n
+);
+
 /**
  * @brief Get pointer to cached STFMA-encoded weights
  * 
@@ -73,6 +96,24 @@ void ggml_bitnet_stfma_cache_shutdown(void);
  */
 void ggml_bitnet_stfma_cache_stats(size_t* num_entries, size_t* total_bytes);
 
+/**
+ * @brief Dot product against cached weights (drop-in for ggml_vec_dot_i2_i8_s)
+ * 
+ * The result follows the ggml_vec_dot_i2_i8_s convention of sum((w + 1) * y),
+ * so the caller's activation-sum correction applies unchanged.
+ * 
+ * @param n Number of elements
+ * @param s Output: dot product result
+ * @param vx_handle Cached STFMA weights handle
+ * @param vy int8 activations
+ */
+void ggml_vec_dot_i2_i8_s_stfma_cached(
+    int n,
+    float* s,
+    ggml_bitnet_stfma_cache_handle vx_handle,
+    const void* vy
+);
+
 #ifdef __cplusplus
 }
 #endif
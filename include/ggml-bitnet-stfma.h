@@ -33,6 +33,26 @@ extern "C" {
 #define GGML_BITNET_STFMA_THRESHOLD 1024
 #endif
 
+/* ========================================================================== */
+/* Trit Decoding                                                              */
+/* ========================================================================== */
+
+/**
+ * Decode one 2-bit STFMA trit to its signed value.
+ *
+ * STFMA encoding: 0b00→0, 0b01→+1, 0b10→-1 (0b11 is unused and decodes to 0)
+ *
+ * This is the single authoritative decode: value = (trit & 1) - (trit >> 1).
+ * The SIMD kernels (AVX2, AVX-512) apply the same two operations per lane, so
+ * every ISA variant produces identical results.
+ *
+ * @param trit 2-bit trit in STFMA encoding
+ * @return Signed ternary value in {-1, 0, +1}
+ */
+static inline int32_t stfma_decode_trit(uint8_t trit) {
+    return (int32_t)(trit & 1) - (int32_t)(trit >> 1);
+}
+
 /* ========================================================================== */
 /* Encoding Conversion Functions                                             */
 /* ========================================================================== */
@@ -191,6 +211,22 @@ void sparse_ternary_fma_int32(
     size_t N
 );
 
+/**
+ * Dense ternary dot product on linear STFMA weights: sum(w * activations)
+ * 
+ * Dispatched to the widest kernel of the build (AVX-512, AVX2 or a scalar
+ * loop over stfma_decode_trit()), for any n.
+ * 
+ * @param weights Packed ternary array (STFMA encoding) [n/4 bytes]
+ * @param activations Dense int32 array [n]
+ * @param n Array length
+ */
+int32_t ggml_bitnet_stfma_dense(
+    const uint8_t* weights,
+    const int32_t* activations,
+    size_t n
+);
+
 /* ========================================================================== */
 /* BitNet Integration Functions                                              */
 /* ========================================================================== */
@@ -198,8 +234,11 @@ void sparse_ternary_fma_int32(
 /**
  * Vector dot product using sparse-ternary-fma (drop-in replacement).
  * 
- * This function is a drop-in replacement for ggml_vec_dot_i2_i8_s that uses
- * the sparse-ternary-fma library for improved performance on supported hardware.
+ * ggml_vec_dot_i2_i8_s calls it for rows of GGML_BITNET_STFMA_THRESHOLD
+ * elements or more. The I2_S row is repacked with
+ * ggml_bitnet_stfma_repack_i2_s() and run through the same dense kernel as the
+ * cached path, and the result keeps the sum((w + 1) * y) convention of
+ * ggml_vec_dot_i2_i8_s. Defined in ggml-bitnet-stfma-inference.cpp.
  * 
  * @param n Vector length
  * @param s Output scalar (dot product result)
@@ -247,6 +286,13 @@ void stfma_ensure_buffer_size(size_t required_size);
  */
 void stfma_free_buffers(void);
 
+/**
+ * Get the calling thread's buffers (sized by the last stfma_ensure_buffer_size call).
+ *
+ * @return Pointer to the thread-local buffer structure
+ */
+struct stfma_thread_buffers* stfma_get_thread_buffers(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,100 @@
+#ifndef GGML_BITNET_SYNC_H
+#define GGML_BITNET_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Low-latency fork/join for the BitNet ops
+ *
+ * At batch size 1 a ternary GEMV takes a few microseconds, so waking
+ * threads through a mutex and condition variable costs as much as the
+ * work. A team keeps its workers across consecutive ops, and every fork,
+ * join and barrier waits in two stages:
+ * - spin on a generation counter for an adaptive budget;
+ * - then park on a futex (WaitOnAddress on Windows).
+ * Each worker has its own cache line for its go flag and spin state, so a
+ * fork writes one line per participating worker and only parked workers
+ * take a syscall.
+ *
+ * The spin budget adapts per thread. If a park ended shortly after the
+ * budget ran out, the budget doubles. If a wait lasted much longer than
+ * the maximum (the process idles between tokens), the budget halves, so an
+ * idle team stops burning cores. A team larger than the cores the process
+ * may use never spins.
+ */
+
+/**
+ * @brief Bounds of the adaptive spin budget, in nanoseconds
+ */
+#define GGML_BITNET_SYNC_SPIN_MIN_NS     1000
+#define GGML_BITNET_SYNC_SPIN_MAX_NS   200000
+#define GGML_BITNET_SYNC_SPIN_INIT_NS   50000
+
+struct ggml_bitnet_team;
+
+/**
+ * @brief One task of a team run: thread ith of nth
+ */
+typedef void (*ggml_bitnet_team_task)(void* ctx, int ith, int nth);
+
+/**
+ * @brief Wait statistics of a team, summed over its threads
+ */
+struct ggml_bitnet_team_stats {
+    uint64_t runs;          // fork/joins
+    uint64_t barriers;      // barrier rounds
+    uint64_t waits;         // waits of any kind (fork, join, barrier)
+    uint64_t spin_waits;    // waits that ended while spinning
+    uint64_t parks;         // waits that parked on the futex
+    uint64_t wakes;         // futex wake calls issued
+};
+
+/**
+ * @brief Start a team of n_threads (the caller counts as thread 0)
+ *
+ * @param n_threads Team size, >= 1; n_threads - 1 workers are started
+ * @return Team, or NULL on failure
+ */
+struct ggml_bitnet_team* ggml_bitnet_team_create(int n_threads);
+
+/**
+ * @brief Stop the workers and free the team (NULL is ignored)
+ */
+void ggml_bitnet_team_free(struct ggml_bitnet_team* team);
+
+/**
+ * @brief Team size
+ */
+int ggml_bitnet_team_size(const struct ggml_bitnet_team* team);
+
+/**
+ * @brief Run task(ctx, ith, nth) on threads 0 .. nth - 1 and wait for all of them
+ *
+ * The calling thread runs ith 0. nth is clamped to the team size; workers
+ * past nth are not woken. Runs must not overlap: one thread drives a team.
+ */
+void ggml_bitnet_team_run(struct ggml_bitnet_team* team, ggml_bitnet_team_task task, void* ctx, int nth);
+
+/**
+ * @brief Barrier of the nth threads of the current run
+ *
+ * Call it from inside a task, from every thread of the run. Lets one run
+ * hold several dependent phases of an op instead of one fork/join each.
+ */
+void ggml_bitnet_team_barrier(struct ggml_bitnet_team* team);
+
+/**
+ * @brief Read the wait statistics (between runs, from the driving thread)
+ */
+void ggml_bitnet_team_get_stats(const struct ggml_bitnet_team* team, struct ggml_bitnet_team_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GGML_BITNET_SYNC_H
@@ -22,6 +22,14 @@ struct bitnet_tensor_extra {
     bitnet_float_type * scales;
 };
 
+// int8 KV cache: blocks of BITNET_QK_KV values with an f16 scale (the Q8_0 layout), 34 bytes per 32 values instead of 64 for f16
+#define BITNET_QK_KV 32
+
+typedef struct {
+    ggml_fp16_t d;
+    int8_t qs[BITNET_QK_KV];
+} bitnet_kv_block_i8;
+
 GGML_API void ggml_bitnet_init(void);
 GGML_API void ggml_bitnet_free(void);
 // src0->type == Q4_0/IQ2_XXS/IQ3_XXS
@@ -35,13 +43,32 @@ GGML_API void ggml_bitnet_mul_mat_task_compute(void * src0, void * scales, void
 GGML_API void ggml_bitnet_transform_tensor(struct ggml_tensor * tensor);
 GGML_API int ggml_bitnet_get_type_bits(enum ggml_type type);
 GGML_API void ggml_bitnet_set_n_threads(int n_threads);
+// n must be a multiple of BITNET_QK_KV
+GGML_API void ggml_bitnet_kv_quantize_row_i8(const float * x, bitnet_kv_block_i8 * y, int n);
+GGML_API void ggml_bitnet_kv_dequantize_row_i8(const bitnet_kv_block_i8 * x, float * y, int n);
+GGML_API float ggml_bitnet_kv_vec_dot_i8(int n, const bitnet_kv_block_i8 * x, const bitnet_kv_block_i8 * y);
+// V is stored transposed (head_dim rows of n_ctx tokens); writes token pos, rescaling a block when a value exceeds its scale
+GGML_API void ggml_bitnet_kv_store_v_i8(int head_dim, int n_ctx, bitnet_kv_block_i8 * vt, int pos, const float * v);
+// single-head decode attention over n_kv cached tokens (n_kv a multiple of BITNET_QK_KV, unused tail keys are masked)
+// scores: n_kv floats of scratch, the softmax weights are kept in float for softmax * V
+GGML_API void ggml_bitnet_kv_attn_i8(int n_kv, int n_past, int head_dim, int n_ctx, const float * q, const bitnet_kv_block_i8 * k,
+                                     const bitnet_kv_block_i8 * vt, float scale, float * scores, float * out);
 #if defined(GGML_BITNET_ARM_TL1)
 GGML_API void ggml_qgemm_lut(int m, int k, void* A, void* LUT, void* Scales, void* LUT_Scales, void* C);
 GGML_API void ggml_preprocessor(int m, int k, void* B, void* LUT_Scales, void* QLUT);
+// thread ith of nth computes the scales of its share of the bs columns of B
+GGML_API void ggml_preprocessor_scales_mt(int ith, int nth, int bs, int k, void* B, void* LUT_Scales);
+// after a barrier behind ggml_preprocessor_scales_mt: thread ith of nth builds its share of the K-blocks of QLUT
+GGML_API void ggml_preprocessor_mt(int ith, int nth, int k, void* B, void* LUT_Scales, void* QLUT);
 #endif
 #if defined(GGML_BITNET_X86_TL2)
 GGML_API void ggml_qgemm_lut(int bs, int m, int k, int BK, void* A, void* sign, void* LUT, void* Scales, void* LUT_Scales, void* C);
 GGML_API void ggml_preprocessor(int bs, int m, int three_k, int two_k, void* B, void* LUT_Scales, void* Three_QLUT, void* Two_QLUT);
+// thread ith of nth computes the scales of its share of the bs columns of B
+GGML_API void ggml_preprocessor_scales_mt(int ith, int nth, int bs, int three_k, int two_k, void* B, void* LUT_Scales);
+// after a barrier behind ggml_preprocessor_scales_mt: thread ith of nth builds its share of the bs columns
+// (and K-blocks when bs < nth) of Three_QLUT / Two_QLUT
+GGML_API void ggml_preprocessor_mt(int ith, int nth, int bs, int three_k, int two_k, void* B, void* LUT_Scales, void* Three_QLUT, void* Two_QLUT);
 #endif
 
 #ifdef  __cplusplus
@@ -0,0 +1,86 @@
+#pragma once
+
+// Reference thread pool for the benchmarks: the usual mutex and condition
+// variable design, what a caller without bitnet_kernels_team would write.
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bitnet-kernels.h"
+
+// persistent pool: workers wait for a region, the caller runs task 0
+struct condvar_pool {
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    bitnet_kernels_task task = nullptr;
+    void * task_ctx = nullptr;
+    int nth = 1;
+    int pending = 0;
+    uint64_t generation = 0;
+    bool stop = false;
+
+    explicit condvar_pool(int n_threads) {
+        for (int i = 1; i < n_threads; i++) {
+            workers.emplace_back([this, i] { worker(i); });
+        }
+    }
+
+    ~condvar_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        start_cv.notify_all();
+        for (auto & w : workers) {
+            w.join();
+        }
+    }
+
+    void worker(int ith) {
+        uint64_t seen = 0;
+        for (;;) {
+            bitnet_kernels_task t;
+            void * ctx;
+            int n;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_cv.wait(lock, [&] { return stop || generation != seen; });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+                t = task;
+                ctx = task_ctx;
+                n = nth;
+            }
+            if (ith < n) {
+                t(ctx, ith, n);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                done_cv.notify_one();
+            }
+        }
+    }
+
+    static void parallel_for(void * p, bitnet_kernels_task task, void * task_ctx, int nth) {
+        condvar_pool * self = (condvar_pool *) p;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex);
+            self->task = task;
+            self->task_ctx = task_ctx;
+            self->nth = nth;
+            self->pending = (int) self->workers.size();
+            self->generation++;
+        }
+        self->start_cv.notify_all();
+        task(task_ctx, 0, nth);
+        std::unique_lock<std::mutex> lock(self->mutex);
+        self->done_cv.wait(lock, [&] { return self->pending == 0; });
+    }
+};
@@ -0,0 +1,171 @@
+/**
+ * Benchmark of the standalone kernel library
+ *
+ * Times GEMV (one token) and GEMM (a small batch) of every kernel family
+ * built in through the C ABI, on the library's worker team or a
+ * mutex/condvar pool of the caller (--pool), and
+ * reports the median time, the weight bandwidth of GEMV and the ternary
+ * multiply-add rate of GEMM. With --budget the bandwidth governor caps the
+ * run and each shape also reports achieved versus budgeted bandwidth.
+ *
+ * Usage: bench-bitnet-kernels [--threads N] [--iters N] [--warmup N] [--batch N] [--kind NAME] [--budget GBPS]
+ *                             [--pool team|condvar] [--quick]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bitnet-kernels.h"
+#include "bench-pool.h"
+
+struct options {
+    int threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    int iters = 50;
+    int warmup = 5;
+    int batch = 8;
+    std::string kind;
+    double budget = 0.0;
+    std::string pool = "team";
+    bool quick = false;
+};
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+static void bench_shape(int kind, int m, int k, const options & opt, bitnet_kernels_parallel_for parallel_for, void * workers) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> tdist(-1, 1);
+    std::normal_distribution<float> xdist(0.0f, 1.0f);
+
+    std::vector<int8_t> t((size_t) m * k);
+    for (auto & v : t) v = (int8_t) tdist(rng);
+    bitnet_kernels_weights * w = nullptr;
+    int status = bitnet_kernels_prepack(kind, m, k, t.data(), 1.0f, &w);
+    if (status != BITNET_KERNELS_OK) {
+        printf("%-6s %6d x %-6d prepack failed: %s\n", bitnet_kernels_kind_name(kind), m, k, bitnet_kernels_status_string(status));
+        return;
+    }
+    size_t bytes = 0;
+    bitnet_kernels_weights_info(w, nullptr, nullptr, nullptr, &bytes);
+
+    for (int n : {1, opt.batch}) {
+        std::vector<float> x((size_t) n * k), y((size_t) n * m);
+        for (auto & v : x) v = xdist(rng);
+        std::vector<uint8_t> workspace(bitnet_kernels_workspace_size(w, n, opt.threads));
+
+        bitnet_kernels_exec exec;
+        memset(&exec, 0, sizeof(exec));
+        exec.struct_size = sizeof(exec);
+        exec.parallel_for = parallel_for;
+        exec.pool = workers;
+        exec.n_threads = opt.threads;
+        exec.workspace = workspace.data();
+        exec.workspace_size = workspace.size();
+
+        bitnet_kernels_bandwidth report;
+        report.struct_size = sizeof(report);
+        std::vector<double> times;
+        for (int i = 0; i < opt.warmup + opt.iters; i++) {
+            if (i == opt.warmup) {
+                bitnet_kernels_bandwidth_report(&report, 1);
+            }
+            const auto t0 = std::chrono::steady_clock::now();
+            status = bitnet_kernels_gemm(w, n, x.data(), y.data(), &exec);
+            const auto t1 = std::chrono::steady_clock::now();
+            if (i >= opt.warmup) {
+                times.push_back(std::chrono::duration<double>(t1 - t0).count());
+            }
+        }
+        bitnet_kernels_bandwidth_report(&report, 1);
+        if (status != BITNET_KERNELS_OK) {
+            printf("%-6s %6d x %-6d gemm failed: %s\n", bitnet_kernels_kind_name(kind), m, k, bitnet_kernels_status_string(status));
+            break;
+        }
+        const double s = median(times);
+        printf("%-6s %6d x %-6d n=%-3d %10.1f us %8.2f GB/s %8.2f GMAC/s", bitnet_kernels_kind_name(kind), m, k, n,
+               s * 1e6, bytes / s / 1e9, (double) m * k * n / s / 1e9);
+        if (opt.budget > 0.0) {
+            printf("   governor %6.2f of %.2f GB/s, throttled %.1f ms", report.achieved_gbps, report.budget_gbps,
+                   report.throttled_ns / 1e6);
+        }
+        printf("\n");
+    }
+    bitnet_kernels_weights_free(w);
+}
+
+int main(int argc, char ** argv) {
+    options opt;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--iters" && i + 1 < argc) {
+            opt.iters = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            opt.warmup = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            opt.batch = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--kind" && i + 1 < argc) {
+            opt.kind = argv[++i];
+        } else if (arg == "--pool" && i + 1 < argc && (std::string(argv[i + 1]) == "team" || std::string(argv[i + 1]) == "condvar")) {
+            opt.pool = argv[++i];
+        } else if (arg == "--budget" && i + 1 < argc) {
+            opt.budget = std::max(0.0, atof(argv[++i]));
+        } else if (arg == "--quick") {
+            opt.quick = true;
+        } else {
+            fprintf(stderr, "usage: %s [--threads N] [--iters N] [--warmup N] [--batch N] [--kind i2_s|tl1|tl2|stfma] [--budget GBPS] [--pool team|condvar] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("bitnet_kernels %u.%u, isa mask %u, %d threads on a %s pool\n", bitnet_kernels_version() >> 16,
+           bitnet_kernels_version() & 0xffff, bitnet_kernels_isa(), opt.threads, opt.pool.c_str());
+    condvar_pool condvar_workers(opt.pool == "condvar" ? opt.threads : 1);
+    bitnet_kernels_team * team = nullptr;
+    if (opt.pool == "team" && bitnet_kernels_team_create(opt.threads, &team) != BITNET_KERNELS_OK) {
+        fprintf(stderr, "cannot start a team of %d threads\n", opt.threads);
+        return 1;
+    }
+    const bitnet_kernels_parallel_for parallel_for = team != nullptr ? bitnet_kernels_team_parallel_for : condvar_pool::parallel_for;
+    void * workers = team != nullptr ? (void *) team : (void *) &condvar_workers;
+    if (opt.budget > 0.0) {
+        bitnet_kernels_set_bandwidth_budget(opt.budget, BITNET_KERNELS_BW_PACE | BITNET_KERNELS_BW_THREADS);
+    }
+
+    // BitNet b1.58 2B4T projections; --quick runs one small shape
+    std::vector<std::pair<int, int>> dense_shapes = {{2560, 2560}, {6912, 2560}, {2560, 6912}};
+    if (opt.quick) {
+        dense_shapes = {{256, 1024}};
+    }
+
+    for (int kind = 0; kind < BITNET_KERNELS_KIND_COUNT; kind++) {
+        if (!bitnet_kernels_supports(kind) || (!opt.kind.empty() && opt.kind != bitnet_kernels_kind_name(kind))) {
+            continue;
+        }
+        if (kind == BITNET_KERNELS_TL1 || kind == BITNET_KERNELS_TL2) {
+            // only the shapes generated into this build
+            const int n = bitnet_kernels_lut_shapes(kind, nullptr, 0);
+            std::vector<int> shapes(2 * n);
+            bitnet_kernels_lut_shapes(kind, shapes.data(), n);
+            for (int i = 0; i < (opt.quick ? std::min(n, 1) : n); i++) {
+                bench_shape(kind, shapes[2 * i], shapes[2 * i + 1], opt, parallel_for, workers);
+            }
+        } else {
+            for (const auto & s : dense_shapes) {
+                bench_shape(kind, s.first, s.second, opt, parallel_for, workers);
+            }
+        }
+    }
+    bitnet_kernels_team_free(team);
+    return 0;
+}
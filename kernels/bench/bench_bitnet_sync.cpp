@@ -0,0 +1,181 @@
+/**
+ * Fork/join and barrier cost versus thread count
+ *
+ * For 1, 2, 4, ... threads, compares the library's worker team (spin then
+ * futex park, per-thread generation flags) with a mutex/condvar pool:
+ * - the cost of one fork/join of an empty task;
+ * - the cost of one barrier inside a run (a condvar barrier for the pool);
+ * - a 2560 x 2560 I2_S GEMV at batch size 1, where the GEMV is only a few
+ *   microseconds and the synchronization decides whether threads help.
+ *
+ * Usage: bench-bitnet-sync [--max-threads N] [--iters N] [--quick]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bitnet-kernels.h"
+#include "bench-pool.h"
+
+static double now_ns() {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// median over batches of iters calls, in ns per call
+template <typename F>
+static double time_per_call(int iters, F && call) {
+    std::vector<double> samples;
+    for (int batch = 0; batch < 7; batch++) {
+        const double t0 = now_ns();
+        for (int i = 0; i < iters; i++) {
+            call();
+        }
+        samples.push_back((now_ns() - t0) / iters);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static void empty_task(void * ctx, int ith, int nth) {
+    (void) ctx; (void) ith; (void) nth;
+}
+
+// the condvar baseline of bitnet_kernels_team_barrier
+struct condvar_barrier {
+    std::mutex mutex;
+    std::condition_variable cv;
+    int count = 0;
+    uint64_t generation = 0;
+
+    void wait(int nth) {
+        std::unique_lock<std::mutex> lock(mutex);
+        const uint64_t gen = generation;
+        if (++count == nth) {
+            count = 0;
+            generation++;
+            cv.notify_all();
+            return;
+        }
+        cv.wait(lock, [&] { return generation != gen; });
+    }
+};
+
+struct barrier_ctx {
+    bitnet_kernels_team * team;
+    condvar_barrier * cv_barrier;
+    int rounds;
+};
+
+static void team_barrier_task(void * ctx, int ith, int nth) {
+    (void) ith; (void) nth;
+    const barrier_ctx * b = (const barrier_ctx *) ctx;
+    for (int r = 0; r < b->rounds; r++) {
+        bitnet_kernels_team_barrier(b->team);
+    }
+}
+
+static void condvar_barrier_task(void * ctx, int ith, int nth) {
+    (void) ith;
+    const barrier_ctx * b = (const barrier_ctx *) ctx;
+    for (int r = 0; r < b->rounds; r++) {
+        b->cv_barrier->wait(nth);
+    }
+}
+
+int main(int argc, char ** argv) {
+    int max_threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    int iters = 2000;
+    bool quick = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--max-threads" && i + 1 < argc) {
+            max_threads = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--iters" && i + 1 < argc) {
+            iters = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--quick") {
+            quick = true;
+        } else {
+            fprintf(stderr, "usage: %s [--max-threads N] [--iters N] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (quick) {
+        max_threads = std::min(max_threads, 2);
+        iters = std::min(iters, 20);
+    }
+
+    const int m = quick ? 256 : 2560, k = quick ? 1024 : 2560;
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> tdist(-1, 1);
+    std::normal_distribution<float> xdist(0.0f, 1.0f);
+    std::vector<int8_t> t((size_t) m * k);
+    for (auto & v : t) v = (int8_t) tdist(rng);
+    std::vector<float> x(k), y(m);
+    for (auto & v : x) v = xdist(rng);
+    bitnet_kernels_weights * w = nullptr;
+    if (bitnet_kernels_prepack(BITNET_KERNELS_I2_S, m, k, t.data(), 1.0f, &w) != BITNET_KERNELS_OK) {
+        fprintf(stderr, "prepack failed\n");
+        return 1;
+    }
+    std::vector<uint8_t> workspace(bitnet_kernels_workspace_size(w, 1, max_threads));
+
+    printf("%d cores; ns per fork/join and per barrier, us per %d x %d I2_S GEMV\n",
+           (int) std::thread::hardware_concurrency(), m, k);
+    printf("%7s | %12s %12s | %12s %12s | %10s %10s\n", "threads", "fork team", "fork condvar",
+           "barrier team", "barrier cv", "gemv team", "gemv cv");
+
+    for (int nth = 1; nth <= max_threads; nth = nth < max_threads && nth * 2 > max_threads ? max_threads : nth * 2) {
+        bitnet_kernels_team * team = nullptr;
+        if (bitnet_kernels_team_create(nth, &team) != BITNET_KERNELS_OK) {
+            fprintf(stderr, "cannot start a team of %d threads\n", nth);
+            return 1;
+        }
+        condvar_pool pool(nth);
+        condvar_barrier cv_barrier;
+
+        const double fork_team = time_per_call(iters, [&] { bitnet_kernels_team_parallel_for(team, empty_task, nullptr, nth); });
+        const double fork_cv = time_per_call(iters, [&] { condvar_pool::parallel_for(&pool, empty_task, nullptr, nth); });
+
+        // one run of `rounds` barriers; the fork/join is amortized away
+        barrier_ctx b = { team, &cv_barrier, 100 };
+        const int barrier_iters = std::max(1, iters / b.rounds);
+        const double barrier_team = time_per_call(barrier_iters, [&] {
+            bitnet_kernels_team_parallel_for(team, team_barrier_task, &b, nth);
+        }) / b.rounds;
+        const double barrier_cv = time_per_call(barrier_iters, [&] {
+            condvar_pool::parallel_for(&pool, condvar_barrier_task, &b, nth);
+        }) / b.rounds;
+
+        bitnet_kernels_exec exec;
+        memset(&exec, 0, sizeof(exec));
+        exec.struct_size = sizeof(exec);
+        exec.n_threads = nth;
+        exec.workspace = workspace.data();
+        exec.workspace_size = workspace.size();
+        exec.parallel_for = bitnet_kernels_team_parallel_for;
+        exec.pool = team;
+        const double gemv_team = time_per_call(std::max(1, iters / 10), [&] { bitnet_kernels_gemv(w, x.data(), y.data(), &exec); });
+        exec.parallel_for = condvar_pool::parallel_for;
+        exec.pool = &pool;
+        const double gemv_cv = time_per_call(std::max(1, iters / 10), [&] { bitnet_kernels_gemv(w, x.data(), y.data(), &exec); });
+
+        printf("%7d | %12.0f %12.0f | %12.0f %12.0f | %10.1f %10.1f\n", nth, fork_team, fork_cv,
+               barrier_team, barrier_cv, gemv_team / 1e3, gemv_cv / 1e3);
+        bitnet_kernels_team_free(team);
+        if (nth == max_threads) {
+            break;
+        }
+    }
+    bitnet_kernels_weights_free(w);
+    return 0;
+}
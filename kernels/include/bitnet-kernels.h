@@ -0,0 +1,293 @@
+#ifndef BITNET_KERNELS_H
+#define BITNET_KERNELS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(BITNET_KERNELS_SHARED)
+#    if defined(_WIN32)
+#        if defined(BITNET_KERNELS_BUILD)
+#            define BITNET_KERNELS_API __declspec(dllexport)
+#        else
+#            define BITNET_KERNELS_API __declspec(dllimport)
+#        endif
+#    else
+#        define BITNET_KERNELS_API __attribute__((visibility("default")))
+#    endif
+#else
+#    define BITNET_KERNELS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * BitNet ternary kernels, standalone C ABI
+ *
+ * The I2_S (MAD), TL1, TL2 and STFMA matmul kernels without ggml or
+ * llama.cpp. Weights are prepacked once into an opaque handle; GEMV/GEMM
+ * take float activations and produce float outputs. The library never
+ * creates threads or allocates during a call: the caller passes its own
+ * parallel-for and a workspace of bitnet_kernels_workspace_size() bytes.
+ *
+ * ABI rules: handles are opaque, structs passed in carry their own size
+ * and only grow at the end, enum values are never renumbered. A minor
+ * version adds functions or fields, a major version breaks the ABI.
+ */
+
+#define BITNET_KERNELS_VERSION_MAJOR 1
+#define BITNET_KERNELS_VERSION_MINOR 2
+#define BITNET_KERNELS_VERSION ((BITNET_KERNELS_VERSION_MAJOR << 16) | BITNET_KERNELS_VERSION_MINOR)
+
+/**
+ * @brief Status codes, 0 is success
+ */
+enum bitnet_kernels_status {
+    BITNET_KERNELS_OK               =  0,
+    BITNET_KERNELS_ERR_INVALID      = -1,   // bad argument or shape
+    BITNET_KERNELS_ERR_UNSUPPORTED  = -2,   // kernel not built, or shape not generated (TL1/TL2)
+    BITNET_KERNELS_ERR_WORKSPACE    = -3,   // workspace missing or too small
+    BITNET_KERNELS_ERR_NOMEM        = -4,
+    BITNET_KERNELS_ERR_VERSION      = -5,   // header newer than the library, or other major
+};
+
+/**
+ * @brief Kernel families
+ */
+enum bitnet_kernels_kind {
+    BITNET_KERNELS_I2_S  = 0,   // 2-bit MAD kernel, any shape with k % 128 == 0
+    BITNET_KERNELS_TL1   = 1,   // ARM lookup-table kernel, shapes generated at build time
+    BITNET_KERNELS_TL2   = 2,   // x86 lookup-table kernel, shapes generated at build time
+    BITNET_KERNELS_STFMA = 3,   // sparse-ternary-fma dense kernel, any shape with k % 128 == 0
+};
+
+#define BITNET_KERNELS_KIND_COUNT 4
+
+/**
+ * @brief Instruction sets the library was compiled for
+ */
+enum bitnet_kernels_isa {
+    BITNET_KERNELS_ISA_AVX2     = 1 << 0,
+    BITNET_KERNELS_ISA_AVX512   = 1 << 1,
+    BITNET_KERNELS_ISA_NEON     = 1 << 2,
+    BITNET_KERNELS_ISA_DOTPROD  = 1 << 3,
+};
+
+/**
+ * @brief Version of the library, (major << 16) | minor
+ */
+BITNET_KERNELS_API uint32_t bitnet_kernels_version(void);
+
+/**
+ * @brief Check that the library can serve a caller built against a header version
+ *
+ * Pass BITNET_KERNELS_VERSION. Succeeds when the majors match and the
+ * library minor is at least the header minor.
+ *
+ * @return BITNET_KERNELS_OK or BITNET_KERNELS_ERR_VERSION
+ */
+BITNET_KERNELS_API int bitnet_kernels_check_version(uint32_t header_version);
+
+/**
+ * @brief Bitmask of bitnet_kernels_isa the library was built with
+ */
+BITNET_KERNELS_API uint32_t bitnet_kernels_isa(void);
+
+/**
+ * @brief Whether a kernel family is built into the library
+ */
+BITNET_KERNELS_API int bitnet_kernels_supports(int kind);
+
+/**
+ * @brief Whether a kernel family can run an m x k weight matrix
+ */
+BITNET_KERNELS_API int bitnet_kernels_supports_shape(int kind, int m, int k);
+
+/**
+ * @brief Weight shapes of a lookup-table family (TL1/TL2)
+ *
+ * @param kind Kernel family
+ * @param shapes Output (m, k) pairs, may be NULL
+ * @param max_shapes Capacity of shapes in pairs
+ * @return Number of shapes built into the library, 0 for other families
+ */
+BITNET_KERNELS_API int bitnet_kernels_lut_shapes(int kind, int * shapes, int max_shapes);
+
+/**
+ * @brief Name of a kernel family ("i2_s", "tl1", "tl2", "stfma")
+ */
+BITNET_KERNELS_API const char * bitnet_kernels_kind_name(int kind);
+
+/**
+ * @brief Description of a status code
+ */
+BITNET_KERNELS_API const char * bitnet_kernels_status_string(int status);
+
+/**
+ * @brief Prepacked weights of one m x k ternary matrix
+ */
+typedef struct bitnet_kernels_weights bitnet_kernels_weights;
+
+/**
+ * @brief Prepack a ternary matrix for a kernel family
+ *
+ * @param kind Kernel family
+ * @param m Output rows
+ * @param k Input columns
+ * @param ternary m * k row-major values in {-1, 0, 1}
+ * @param scale Weight scale, y = scale * (W x)
+ * @param out Output handle, free with bitnet_kernels_weights_free()
+ * @return Status
+ */
+BITNET_KERNELS_API int bitnet_kernels_prepack(int kind, int m, int k, const int8_t * ternary, float scale,
+                                              bitnet_kernels_weights ** out);
+
+/**
+ * @brief Prepack a matrix stored as I2_S (the GGUF layout, m rows of k / 4 bytes)
+ *
+ * The scale is passed separately; in GGUF it is the float after the packed rows.
+ */
+BITNET_KERNELS_API int bitnet_kernels_prepack_i2_s(int kind, int m, int k, const uint8_t * i2_s, float scale,
+                                                   bitnet_kernels_weights ** out);
+
+/**
+ * @brief Free a handle (NULL is ignored)
+ */
+BITNET_KERNELS_API void bitnet_kernels_weights_free(bitnet_kernels_weights * w);
+
+/**
+ * @brief Shape and packed size of a handle; any output may be NULL
+ */
+BITNET_KERNELS_API int bitnet_kernels_weights_info(const bitnet_kernels_weights * w, int * kind, int * m, int * k,
+                                                   size_t * bytes);
+
+/**
+ * @brief One task of a parallel region: thread ith of nth
+ */
+typedef void (*bitnet_kernels_task)(void * task_ctx, int ith, int nth);
+
+/**
+ * @brief Caller-provided parallel for
+ *
+ * Must run task(task_ctx, ith, nth) for every ith in [0, nth), on any
+ * threads and in any order, and return once all of them have finished.
+ * Each GEMV/GEMM issues two regions: activation preprocessing, then rows.
+ */
+typedef void (*bitnet_kernels_parallel_for)(void * pool, bitnet_kernels_task task, void * task_ctx, int nth);
+
+/**
+ * @brief Execution context of a GEMV/GEMM call
+ */
+struct bitnet_kernels_exec {
+    size_t struct_size;                         // sizeof(struct bitnet_kernels_exec)
+    bitnet_kernels_parallel_for parallel_for;   // NULL runs on the calling thread
+    void * pool;                                // passed through to parallel_for
+    int n_threads;                              // nth of every region (>= 1), fewer under a bandwidth budget
+    void * workspace;                           // bitnet_kernels_workspace_size() bytes
+    size_t workspace_size;
+};
+
+/**
+ * @brief Workspace bytes for n input columns on n_threads
+ */
+BITNET_KERNELS_API size_t bitnet_kernels_workspace_size(const bitnet_kernels_weights * w, int n, int n_threads);
+
+/**
+ * @brief y = W x for one column: x has k floats, y has m floats
+ */
+BITNET_KERNELS_API int bitnet_kernels_gemv(const bitnet_kernels_weights * w, const float * x, float * y,
+                                           const struct bitnet_kernels_exec * exec);
+
+/**
+ * @brief y = W x for n columns: x holds n rows of k floats, y holds n rows of m floats
+ */
+BITNET_KERNELS_API int bitnet_kernels_gemm(const bitnet_kernels_weights * w, int n, const float * x, float * y,
+                                           const struct bitnet_kernels_exec * exec);
+
+/**
+ * @brief Persistent worker team, since 1.2
+ *
+ * A ready-made pool for bitnet_kernels_exec: its workers live across
+ * calls and wait on per-thread generation flags, spinning for an adaptive
+ * budget before they park on a futex, so a fork or join costs well under
+ * a microsecond while the team is busy and no CPU while it idles. With a
+ * team as the pool, a GEMV/GEMM runs both of its regions in one fork
+ * with a barrier between them.
+ */
+typedef struct bitnet_kernels_team bitnet_kernels_team;
+
+/**
+ * @brief Start a team of n_threads; the thread that calls GEMV/GEMM is thread 0
+ *
+ * @param n_threads Team size (>= 1), at most the cores available for spinning to pay off
+ * @param out Output team, free with bitnet_kernels_team_free()
+ * @return Status
+ */
+BITNET_KERNELS_API int bitnet_kernels_team_create(int n_threads, bitnet_kernels_team ** out);
+
+/**
+ * @brief Stop and free a team (NULL is ignored)
+ */
+BITNET_KERNELS_API void bitnet_kernels_team_free(bitnet_kernels_team * team);
+
+/**
+ * @brief bitnet_kernels_parallel_for of a team: set it with exec.pool = team
+ *
+ * One thread drives a team at a time; nth is clamped to the team size.
+ */
+BITNET_KERNELS_API void bitnet_kernels_team_parallel_for(void * team, bitnet_kernels_task task, void * task_ctx, int nth);
+
+/**
+ * @brief Barrier of every thread of the current team_parallel_for, called from its tasks
+ */
+BITNET_KERNELS_API void bitnet_kernels_team_barrier(bitnet_kernels_team * team);
+
+/**
+ * @brief Bandwidth governor modes (bit mask), since 1.1
+ */
+enum bitnet_kernels_bandwidth_mode {
+    BITNET_KERNELS_BW_PACE      = 1 << 0,   // pause row tiles until their bytes fit the budget
+    BITNET_KERNELS_BW_THREADS   = 1 << 1,   // run regions on just enough threads to reach the budget
+};
+
+/**
+ * @brief Bandwidth report, since 1.1
+ */
+struct bitnet_kernels_bandwidth {
+    size_t struct_size;         // sizeof(struct bitnet_kernels_bandwidth)
+    double budget_gbps;         // 0 without a budget
+    double achieved_gbps;       // bytes / elapsed_ns
+    double thread_gbps;         // bandwidth one unthrottled thread achieves, 0 before the first call
+    uint64_t bytes;             // weights, activations, LUTs and outputs streamed by every call
+    uint64_t elapsed_ns;        // first to last charged tile
+    uint64_t throttled_ns;      // time threads spent paused, summed over threads
+};
+
+/**
+ * @brief Cap the memory bandwidth of every GEMV/GEMM in the process, since 1.1
+ *
+ * Calls charge the bytes they stream per row tile. Pacing pauses a thread
+ * once the process is ahead of its budget by more than a short burst; the
+ * thread cap makes calls use fewer than exec->n_threads threads.
+ *
+ * @param gbps Budget in GB/s (1e9 bytes per second), 0 to remove it
+ * @param mode bitnet_kernels_bandwidth_mode mask
+ * @return Status
+ */
+BITNET_KERNELS_API int bitnet_kernels_set_bandwidth_budget(double gbps, int mode);
+
+/**
+ * @brief Achieved versus budgeted bandwidth, since 1.1
+ *
+ * @param out Report, struct_size set by the caller
+ * @param reset Non-zero restarts the byte and time counters after reading
+ * @return Status
+ */
+BITNET_KERNELS_API int bitnet_kernels_bandwidth_report(struct bitnet_kernels_bandwidth * out, int reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BITNET_KERNELS_H
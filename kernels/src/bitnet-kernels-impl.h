@@ -0,0 +1,61 @@
+#pragma once
+
+// Internal to the standalone kernel library: the handle layout and the entry
+// points shared between its translation units and the sources it borrows from
+// ../src (built with BITNET_KERNELS_STANDALONE instead of the ggml headers).
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bitnet-kernels.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+// ../src/ggml-bitnet-mad.cpp: sum of the stored I2_S codes (0/1/2) times y
+void ggml_vec_dot_i2_i8_s(int n, float * s, size_t bs, const void * vx, size_t bx, const void * vy, size_t by, int nrc);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#define BITNET_KERNELS_ALIGN 64
+
+struct bitnet_kernels_weights {
+    int kind;
+    int m;
+    int k;
+    float scale;
+    uint8_t * data;     // packed weights, BITNET_KERNELS_ALIGN aligned
+    size_t bytes;
+    // lookup-table tiling (TL1/TL2)
+    int bm;             // rows per ggml_qgemm_lut call
+    int three_k;        // TL2: columns in groups of three
+    int two_k;          // TL2: remaining columns in pairs
+};
+
+void * bitnet_kernels_aligned_alloc(size_t size);
+void bitnet_kernels_aligned_free(void * ptr);
+
+// one parallel region through the caller's parallel for (or serially, same partition)
+void bitnet_kernels_run_region(const struct bitnet_kernels_exec * exec, bitnet_kernels_task task, void * ctx);
+
+// dependent regions in order: one fork with barriers between them on a bitnet_kernels_team, one region each otherwise
+void bitnet_kernels_run_regions(const struct bitnet_kernels_exec * exec, const bitnet_kernels_task * tasks,
+                                int n_tasks, void * ctx);
+
+// charge a tile to the bandwidth governor, busy since t0_ns (ggml_bitnet_rt_now_ns)
+void bitnet_kernels_charge(size_t bytes, uint64_t t0_ns);
+
+// bitnet-kernels-lut.cpp: the lookup-table family built in, if any
+int bitnet_kernels_lut_kind(void);
+int bitnet_kernels_lut_find(int m, int k, int * bm, int * bk, int * bmm);
+int bitnet_kernels_lut_shape_count(void);
+void bitnet_kernels_lut_shape(int i, int * m, int * k);
+
+// pack a ternary matrix into w->data (allocated here), w->m / w->k already set
+int bitnet_kernels_lut_prepack(bitnet_kernels_weights * w, const int8_t * ternary);
+size_t bitnet_kernels_lut_workspace_size(const bitnet_kernels_weights * w, int n);
+void bitnet_kernels_lut_gemm(const bitnet_kernels_weights * w, int n, const float * x, float * y,
+                             const struct bitnet_kernels_exec * exec, uint8_t * workspace);
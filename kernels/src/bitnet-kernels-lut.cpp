@@ -0,0 +1,307 @@
+// TL1/TL2 lookup-table kernels of the standalone library
+//
+// The kernels are the ones utils/codegen_tl1.py / codegen_tl2.py generate for
+// a fixed set of weight shapes (or a preset_kernels/ header); CMake picks the
+// header and writes the shape table from its kernel_config ini. The weight
+// prepacking mirrors preprocess_weights_tl1/tl2 of the GGUF converter, so a
+// handle holds exactly the bytes ggml would read.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitnet-kernels-impl.h"
+#include "ggml-bitnet-pack.h"
+#include "ggml-bitnet-realtime.h"
+
+#if defined(BITNET_KERNELS_LUT_HEADER)
+
+#if defined(GGML_BITNET_ARM_TL1)
+#include <arm_neon.h>
+typedef float32_t bitnet_float_type;
+#else
+#include <immintrin.h>
+typedef float bitnet_float_type;
+#endif
+
+#include BITNET_KERNELS_LUT_HEADER
+#include "bitnet-kernels-lut-shapes.h"
+
+struct lut_shape {
+    int m;
+    int k;
+    int bm;     // BM: rows per tile
+    int bk;     // BY: columns per block
+    int bmm;    // bm: rows per inner block
+};
+
+static const lut_shape lut_shapes[] = { BITNET_KERNELS_LUT_SHAPES };
+
+static const int lut_n_shapes = (int) (sizeof(lut_shapes) / sizeof(lut_shapes[0]));
+
+int bitnet_kernels_lut_kind(void) {
+#if defined(GGML_BITNET_ARM_TL1)
+    return BITNET_KERNELS_TL1;
+#else
+    return BITNET_KERNELS_TL2;
+#endif
+}
+
+int bitnet_kernels_lut_find(int m, int k, int * bm, int * bk, int * bmm) {
+    for (int i = 0; i < lut_n_shapes; i++) {
+        if (lut_shapes[i].m == m && lut_shapes[i].k == k) {
+            if (bm)  *bm = lut_shapes[i].bm;
+            if (bk)  *bk = lut_shapes[i].bk;
+            if (bmm) *bmm = lut_shapes[i].bmm;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int bitnet_kernels_lut_shape_count(void) {
+    return lut_n_shapes;
+}
+
+void bitnet_kernels_lut_shape(int i, int * m, int * k) {
+    *m = lut_shapes[i].m;
+    *k = lut_shapes[i].k;
+}
+
+#if defined(GGML_BITNET_ARM_TL1)
+
+// TL1: pairs (w0, w1) -> 3 * w0 + w1 + 4, two pairs per byte (ggml_bitnet_pack_tl1)
+int bitnet_kernels_lut_prepack(bitnet_kernels_weights * w, const int8_t * ternary) {
+    const int M = w->m, K = w->k;
+    int BM, BY, bm;
+    if (!bitnet_kernels_lut_find(M, K, &BM, &BY, &bm)) {
+        return BITNET_KERNELS_ERR_UNSUPPORTED;
+    }
+    w->bm = BM;
+    w->bytes = (size_t) M * K / 4;
+    w->data = (uint8_t *) bitnet_kernels_aligned_alloc(w->bytes);
+    if (w->data == nullptr) {
+        return BITNET_KERNELS_ERR_NOMEM;
+    }
+    ggml_bitnet_pack_tl1(ternary, M, K, BM, BY, bm, w->data);
+    return BITNET_KERNELS_OK;
+}
+
+size_t bitnet_kernels_lut_workspace_size(const bitnet_kernels_weights * w, int n) {
+    // per column: k / 2 pair LUTs of 32 bytes, then one scale
+    return (size_t) n * w->k * 16 + (size_t) n * sizeof(bitnet_float_type);
+}
+
+struct lut_task {
+    const bitnet_kernels_weights * w;
+    int n;
+    const float * x;
+    float * y;
+    int8_t * qlut;
+    bitnet_float_type * lut_scales;
+};
+
+static void lut_scales_task(void * ctx, int ith, int nth) {
+    const lut_task * t = (const lut_task *) ctx;
+    const uint64_t t0 = ggml_bitnet_rt_now_ns();
+    ggml_preprocessor_scales_mt(ith, nth, t->n, t->w->k, (void *) t->x, t->lut_scales);
+    bitnet_kernels_charge((size_t) t->n * t->w->k * sizeof(float) / nth, t0);
+}
+
+static void lut_preprocess_task(void * ctx, int ith, int nth) {
+    const lut_task * t = (const lut_task *) ctx;
+    const int k = t->w->k;
+    const uint64_t t0 = ggml_bitnet_rt_now_ns();
+    for (int b = 0; b < t->n; b++) {
+        ggml_preprocessor_mt(ith, nth, k, (void *) (t->x + (size_t) b * k), t->lut_scales + b,
+                             t->qlut + (size_t) b * k * 16);
+    }
+    // this thread's share of the float columns read and the LUTs written
+    bitnet_kernels_charge((size_t) t->n * k * (sizeof(float) + 16) / nth, t0);
+}
+
+static void lut_rows_task(void * ctx, int ith, int nth) {
+    const lut_task * t = (const lut_task *) ctx;
+    const bitnet_kernels_weights * w = t->w;
+    const int m = w->m, k = w->k, BM = w->bm;
+    bitnet_float_type scale = w->scale;
+    int start, end;
+    ggml_bitnet_rt_partition(ith, nth, m / BM, 1, &start, &end);
+    for (int tile = start; tile < end; tile++) {
+        const uint64_t t0 = ggml_bitnet_rt_now_ns();
+        uint8_t * a = w->data + (size_t) tile * BM * k / 4;
+        for (int b = 0; b < t->n; b++) {
+            ggml_qgemm_lut(m, k, a, t->qlut + (size_t) b * k * 16, &scale, t->lut_scales + b,
+                           t->y + (size_t) b * m + (size_t) tile * BM);
+        }
+        bitnet_kernels_charge((size_t) BM * k / 4 + (size_t) t->n * BM * sizeof(float), t0);
+    }
+}
+
+void bitnet_kernels_lut_gemm(const bitnet_kernels_weights * w, int n, const float * x, float * y,
+                             const struct bitnet_kernels_exec * exec, uint8_t * workspace) {
+    lut_task t;
+    t.w = w;
+    t.n = n;
+    t.x = x;
+    t.y = y;
+    t.qlut = (int8_t *) workspace;
+    t.lut_scales = (bitnet_float_type *) (workspace + (size_t) n * w->k * 16);
+    // column scales once, then the LUTs from the shared scales, then the rows
+    const bitnet_kernels_task tasks[] = { lut_scales_task, lut_preprocess_task, lut_rows_task };
+    bitnet_kernels_run_regions(exec, tasks, 3, &t);
+}
+
+#else
+
+// TL2: the first three_k columns in triples (9 * w0 + 3 * w1 + w2, stored as
+// magnitude nibbles plus a sign bit plane), the remaining two_k in pairs like TL1.
+// Layout: all triple bytes, then all sign bytes, then all pair bytes, each tile of BM rows contiguous
+// (ggml_bitnet_pack_tl2).
+int bitnet_kernels_lut_prepack(bitnet_kernels_weights * w, const int8_t * ternary) {
+    const int M = w->m, K = w->k;
+    int BM, BY;
+    if (!bitnet_kernels_lut_find(M, K, &BM, &BY, nullptr)) {
+        return BITNET_KERNELS_ERR_UNSUPPORTED;
+    }
+    w->bm = BM;
+    w->three_k = ggml_bitnet_tl2_three_k(K, BY);
+    w->two_k = K - w->three_k;
+    w->bytes = ggml_bitnet_tl2_size(M, K, BY);
+    w->data = (uint8_t *) bitnet_kernels_aligned_alloc(w->bytes);
+    if (w->data == nullptr) {
+        return BITNET_KERNELS_ERR_NOMEM;
+    }
+    ggml_bitnet_pack_tl2(ternary, M, K, BM, BY, w->data);
+    return BITNET_KERNELS_OK;
+}
+
+struct lut_layout {
+    size_t three_lut;   // n * three_k / 3 LUTs of 32 bytes
+    size_t two_lut;     // n * two_k / 2 LUTs of 32 bytes
+    size_t lut_scales;  // n scales
+    size_t size;
+};
+
+static lut_layout lut_workspace(const bitnet_kernels_weights * w, int n) {
+    const size_t a = BITNET_KERNELS_ALIGN;
+    lut_layout l;
+    l.three_lut = 0;
+    l.two_lut = ((size_t) n * w->three_k / 3 * 32 + a - 1) / a * a;
+    l.lut_scales = l.two_lut + ((size_t) n * w->two_k / 2 * 32 + a - 1) / a * a;
+    l.size = l.lut_scales + (size_t) n * sizeof(bitnet_float_type);
+    return l;
+}
+
+size_t bitnet_kernels_lut_workspace_size(const bitnet_kernels_weights * w, int n) {
+    return lut_workspace(w, n).size;
+}
+
+struct lut_task {
+    const bitnet_kernels_weights * w;
+    int n;
+    const float * x;
+    float * y;
+    int8_t * three_lut;
+    int8_t * two_lut;
+    bitnet_float_type * lut_scales;
+};
+
+static void lut_scales_task(void * ctx, int ith, int nth) {
+    const lut_task * t = (const lut_task *) ctx;
+    const uint64_t t0 = ggml_bitnet_rt_now_ns();
+    ggml_preprocessor_scales_mt(ith, nth, t->n, t->w->three_k, t->w->two_k, (void *) t->x, t->lut_scales);
+    bitnet_kernels_charge((size_t) t->n * t->w->k * sizeof(float) / nth, t0);
+}
+
+static void lut_preprocess_task(void * ctx, int ith, int nth) {
+    const lut_task * t = (const lut_task *) ctx;
+    const uint64_t t0 = ggml_bitnet_rt_now_ns();
+    ggml_preprocessor_mt(ith, nth, t->n, t->w->three_k, t->w->two_k, (void *) t->x, t->lut_scales,
+                         t->three_lut, t->two_lut);
+    // this thread's share of the float columns read and the LUTs written
+    const size_t lut_bytes = (size_t) t->w->three_k / 3 * 32 + (size_t) t->w->two_k / 2 * 32;
+    bitnet_kernels_charge((size_t) t->n * (t->w->k * sizeof(float) + lut_bytes) / nth, t0);
+}
+
+static void lut_rows_task(void * ctx, int ith, int nth) {
+    const lut_task * t = (const lut_task *) ctx;
+    const bitnet_kernels_weights * w = t->w;
+    const int m = w->m, k = w->k, BM = w->bm, three_k = w->three_k, two_k = w->two_k;
+    const size_t three_bytes = (size_t) m * three_k / 6;
+    const size_t sign_bytes = (size_t) m * three_k / 24;
+    bitnet_float_type scale = w->scale;
+    int start, end;
+    ggml_bitnet_rt_partition(ith, nth, m / BM, 1, &start, &end);
+    for (int tile = start; tile < end; tile++) {
+        const uint64_t t0 = ggml_bitnet_rt_now_ns();
+        uint8_t * a3 = w->data + (size_t) tile * BM * three_k / 6;
+        uint8_t * sign = w->data + three_bytes + (size_t) tile * BM * three_k / 24;
+        uint8_t * a2 = w->data + three_bytes + sign_bytes + (size_t) tile * BM * two_k / 4;
+        for (int b = 0; b < t->n; b++) {
+            float * c = t->y + (size_t) b * m + (size_t) tile * BM;
+            bitnet_float_type * lut_scales = t->lut_scales + b;
+            // the triple pass leaves int32 partial sums in c, the pair pass adds its own and scales to float
+            ggml_qgemm_lut(1, m, k, three_k, a3, sign, t->three_lut + (size_t) b * three_k / 3 * 32, &scale,
+                           lut_scales, c);
+            ggml_qgemm_lut(1, m, k, two_k, a2, nullptr, t->two_lut + (size_t) b * two_k / 2 * 32, &scale,
+                           lut_scales, c);
+        }
+        bitnet_kernels_charge((size_t) BM * (three_k / 6 + three_k / 24 + two_k / 4) + (size_t) t->n * BM * sizeof(float), t0);
+    }
+}
+
+void bitnet_kernels_lut_gemm(const bitnet_kernels_weights * w, int n, const float * x, float * y,
+                             const struct bitnet_kernels_exec * exec, uint8_t * workspace) {
+    const lut_layout l = lut_workspace(w, n);
+    lut_task t;
+    t.w = w;
+    t.n = n;
+    t.x = x;
+    t.y = y;
+    t.three_lut = (int8_t *) (workspace + l.three_lut);
+    t.two_lut = (int8_t *) (workspace + l.two_lut);
+    t.lut_scales = (bitnet_float_type *) (workspace + l.lut_scales);
+    // column scales once, then the LUTs from the shared scales, then the rows
+    const bitnet_kernels_task tasks[] = { lut_scales_task, lut_preprocess_task, lut_rows_task };
+    bitnet_kernels_run_regions(exec, tasks, 3, &t);
+}
+
+#endif // GGML_BITNET_ARM_TL1
+
+#else
+
+// built without a kernel header: no lookup-table family
+
+int bitnet_kernels_lut_kind(void) {
+    return -1;
+}
+
+int bitnet_kernels_lut_find(int m, int k, int * bm, int * bk, int * bmm) {
+    (void) m; (void) k; (void) bm; (void) bk; (void) bmm;
+    return 0;
+}
+
+int bitnet_kernels_lut_shape_count(void) {
+    return 0;
+}
+
+void bitnet_kernels_lut_shape(int i, int * m, int * k) {
+    (void) i; (void) m; (void) k;
+}
+
+int bitnet_kernels_lut_prepack(bitnet_kernels_weights * w, const int8_t * ternary) {
+    (void) w; (void) ternary;
+    return BITNET_KERNELS_ERR_UNSUPPORTED;
+}
+
+size_t bitnet_kernels_lut_workspace_size(const bitnet_kernels_weights * w, int n) {
+    (void) w; (void) n;
+    return 0;
+}
+
+void bitnet_kernels_lut_gemm(const bitnet_kernels_weights * w, int n, const float * x, float * y,
+                             const struct bitnet_kernels_exec * exec, uint8_t * workspace) {
+    (void) w; (void) n; (void) x; (void) y; (void) exec; (void) workspace;
+}
+
+#endif // BITNET_KERNELS_LUT_HEADER
@@ -0,0 +1,536 @@
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bitnet-kernels-impl.h"
+#include "ggml-bitnet-realtime.h"
+#include "ggml-bitnet-bandwidth.h"
+#include "ggml-bitnet-sync.h"
+#include "ggml-bitnet-pack.h"
+#include "ggml-bitnet-stfma.h"
+#include "ggml-bitnet-stfma-cache.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#define QK_I2_S 128
+
+static size_t align_up(size_t n) {
+    return (n + BITNET_KERNELS_ALIGN - 1) / BITNET_KERNELS_ALIGN * BITNET_KERNELS_ALIGN;
+}
+
+void * bitnet_kernels_aligned_alloc(size_t size) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, BITNET_KERNELS_ALIGN);
+#else
+    void * ptr = nullptr;
+    if (posix_memalign(&ptr, BITNET_KERNELS_ALIGN, size ? size : BITNET_KERNELS_ALIGN) != 0) {
+        return nullptr;
+    }
+    return ptr;
+#endif
+}
+
+void bitnet_kernels_aligned_free(void * ptr) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// version and capabilities
+
+uint32_t bitnet_kernels_version(void) {
+    return BITNET_KERNELS_VERSION;
+}
+
+int bitnet_kernels_check_version(uint32_t header_version) {
+    if ((header_version >> 16) != BITNET_KERNELS_VERSION_MAJOR ||
+        (header_version & 0xffff) > BITNET_KERNELS_VERSION_MINOR) {
+        return BITNET_KERNELS_ERR_VERSION;
+    }
+    return BITNET_KERNELS_OK;
+}
+
+uint32_t bitnet_kernels_isa(void) {
+    uint32_t isa = 0;
+#if defined(__AVX2__)
+    isa |= BITNET_KERNELS_ISA_AVX2;
+#endif
+#if defined(__AVX512F__)
+    isa |= BITNET_KERNELS_ISA_AVX512;
+#endif
+#if defined(__ARM_NEON)
+    isa |= BITNET_KERNELS_ISA_NEON;
+#endif
+#if defined(__ARM_FEATURE_DOTPROD)
+    isa |= BITNET_KERNELS_ISA_DOTPROD;
+#endif
+    return isa;
+}
+
+int bitnet_kernels_supports(int kind) {
+    switch (kind) {
+        case BITNET_KERNELS_I2_S:
+        case BITNET_KERNELS_STFMA:
+            return 1;
+        case BITNET_KERNELS_TL1:
+        case BITNET_KERNELS_TL2:
+            return kind == bitnet_kernels_lut_kind();
+        default:
+            return 0;
+    }
+}
+
+int bitnet_kernels_supports_shape(int kind, int m, int k) {
+    if (!bitnet_kernels_supports(kind) || m <= 0 || k <= 0) {
+        return 0;
+    }
+    if (kind == BITNET_KERNELS_I2_S || kind == BITNET_KERNELS_STFMA) {
+        return k % QK_I2_S == 0;
+    }
+    return bitnet_kernels_lut_find(m, k, nullptr, nullptr, nullptr);
+}
+
+int bitnet_kernels_lut_shapes(int kind, int * shapes, int max_shapes) {
+    if ((kind != BITNET_KERNELS_TL1 && kind != BITNET_KERNELS_TL2) || kind != bitnet_kernels_lut_kind()) {
+        return 0;
+    }
+    const int n = bitnet_kernels_lut_shape_count();
+    for (int i = 0; shapes != nullptr && i < n && i < max_shapes; i++) {
+        bitnet_kernels_lut_shape(i, &shapes[2 * i], &shapes[2 * i + 1]);
+    }
+    return n;
+}
+
+const char * bitnet_kernels_kind_name(int kind) {
+    switch (kind) {
+        case BITNET_KERNELS_I2_S:  return "i2_s";
+        case BITNET_KERNELS_TL1:   return "tl1";
+        case BITNET_KERNELS_TL2:   return "tl2";
+        case BITNET_KERNELS_STFMA: return "stfma";
+        default:                   return "unknown";
+    }
+}
+
+const char * bitnet_kernels_status_string(int status) {
+    switch (status) {
+        case BITNET_KERNELS_OK:              return "ok";
+        case BITNET_KERNELS_ERR_INVALID:     return "invalid argument";
+        case BITNET_KERNELS_ERR_UNSUPPORTED: return "kernel or shape not supported by this build";
+        case BITNET_KERNELS_ERR_WORKSPACE:   return "workspace missing or too small";
+        case BITNET_KERNELS_ERR_NOMEM:       return "out of memory";
+        case BITNET_KERNELS_ERR_VERSION:     return "incompatible library version";
+        default:                             return "unknown status";
+    }
+}
+
+// prepacking
+
+static int weights_new(int kind, int m, int k, float scale, bitnet_kernels_weights ** out) {
+    if (kind < 0 || kind >= BITNET_KERNELS_KIND_COUNT || m <= 0 || k <= 0 || !isfinite(scale)) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    if (!bitnet_kernels_supports_shape(kind, m, k)) {
+        return BITNET_KERNELS_ERR_UNSUPPORTED;
+    }
+    bitnet_kernels_weights * w = (bitnet_kernels_weights *) calloc(1, sizeof(bitnet_kernels_weights));
+    if (w == nullptr) {
+        return BITNET_KERNELS_ERR_NOMEM;
+    }
+    w->kind = kind;
+    w->m = m;
+    w->k = k;
+    w->scale = scale;
+    *out = w;
+    return BITNET_KERNELS_OK;
+}
+
+// I2_S and STFMA hold m * k / 4 bytes
+static int weights_alloc_dense(bitnet_kernels_weights * w) {
+    w->bytes = (size_t) w->m * w->k / 4;
+    w->data = (uint8_t *) bitnet_kernels_aligned_alloc(w->bytes);
+    return w->data != nullptr ? BITNET_KERNELS_OK : BITNET_KERNELS_ERR_NOMEM;
+}
+
+int bitnet_kernels_prepack(int kind, int m, int k, const int8_t * ternary, float scale,
+                           bitnet_kernels_weights ** out) {
+    if (out == nullptr) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    *out = nullptr;
+    if (ternary == nullptr) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    const size_t n = (size_t) m * k;
+    for (size_t i = 0; m > 0 && k > 0 && i < n; i++) {
+        if (ternary[i] < -1 || ternary[i] > 1) {
+            return BITNET_KERNELS_ERR_INVALID;
+        }
+    }
+
+    bitnet_kernels_weights * w;
+    int status = weights_new(kind, m, k, scale, &w);
+    if (status != BITNET_KERNELS_OK) {
+        return status;
+    }
+    if (kind == BITNET_KERNELS_I2_S || kind == BITNET_KERNELS_STFMA) {
+        status = weights_alloc_dense(w);
+        if (status == BITNET_KERNELS_OK) {
+            if (kind == BITNET_KERNELS_I2_S) {
+                ggml_bitnet_pack_i2_s(ternary, w->data, n);
+            } else {
+                ggml_bitnet_pack_stfma(ternary, w->data, n);
+            }
+        }
+    } else {
+        status = bitnet_kernels_lut_prepack(w, ternary);
+    }
+    if (status != BITNET_KERNELS_OK) {
+        bitnet_kernels_weights_free(w);
+        return status;
+    }
+    *out = w;
+    return BITNET_KERNELS_OK;
+}
+
+int bitnet_kernels_prepack_i2_s(int kind, int m, int k, const uint8_t * i2_s, float scale,
+                                bitnet_kernels_weights ** out) {
+    if (out == nullptr) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    *out = nullptr;
+    // the I2_S layout itself needs whole blocks
+    if (i2_s == nullptr || k % QK_I2_S != 0) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+
+    bitnet_kernels_weights * w;
+    int status = weights_new(kind, m, k, scale, &w);
+    if (status != BITNET_KERNELS_OK) {
+        return status;
+    }
+    const size_t n = (size_t) m * k;
+    if (kind == BITNET_KERNELS_I2_S) {
+        status = weights_alloc_dense(w);
+        if (status == BITNET_KERNELS_OK) {
+            memcpy(w->data, i2_s, n / 4);
+        }
+    } else if (kind == BITNET_KERNELS_STFMA) {
+        status = weights_alloc_dense(w);
+        if (status == BITNET_KERNELS_OK) {
+            ggml_bitnet_stfma_repack_i2_s(i2_s, w->data, n);
+        }
+    } else {
+        int8_t * ternary = (int8_t *) malloc(n);
+        if (ternary == nullptr) {
+            status = BITNET_KERNELS_ERR_NOMEM;
+        } else {
+            ggml_bitnet_unpack_i2_s(i2_s, ternary, n);
+            status = bitnet_kernels_lut_prepack(w, ternary);
+            free(ternary);
+        }
+    }
+    if (status != BITNET_KERNELS_OK) {
+        bitnet_kernels_weights_free(w);
+        return status;
+    }
+    *out = w;
+    return BITNET_KERNELS_OK;
+}
+
+void bitnet_kernels_weights_free(bitnet_kernels_weights * w) {
+    if (w == nullptr) {
+        return;
+    }
+    bitnet_kernels_aligned_free(w->data);
+    free(w);
+}
+
+int bitnet_kernels_weights_info(const bitnet_kernels_weights * w, int * kind, int * m, int * k, size_t * bytes) {
+    if (w == nullptr) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    if (kind)  *kind = w->kind;
+    if (m)     *m = w->m;
+    if (k)     *k = w->k;
+    if (bytes) *bytes = w->bytes;
+    return BITNET_KERNELS_OK;
+}
+
+// I2_S and STFMA execution
+//
+// Activations are quantized per column to int8 (absmax to 127), as ggml does
+// for the I2_S matmul. The workspace holds, per column, the int8 row, its
+// scale and sum and, for STFMA, the row widened to int32.
+
+struct dense_layout {
+    size_t q;           // n * k int8
+    size_t act_scale;   // n float
+    size_t act_sum;     // n int32
+    size_t act_i32;     // n * k int32 (STFMA)
+    size_t size;
+};
+
+static dense_layout dense_workspace(const bitnet_kernels_weights * w, int n) {
+    dense_layout l;
+    l.q = 0;
+    l.act_scale = align_up(l.q + (size_t) n * w->k);
+    l.act_sum = align_up(l.act_scale + (size_t) n * sizeof(float));
+    l.act_i32 = align_up(l.act_sum + (size_t) n * sizeof(int32_t));
+    l.size = w->kind == BITNET_KERNELS_STFMA ? l.act_i32 + (size_t) n * w->k * sizeof(int32_t) : l.act_i32;
+    return l;
+}
+
+struct dense_task {
+    const bitnet_kernels_weights * w;
+    int n;
+    const float * x;
+    float * y;
+    int8_t * q;
+    float * act_scale;
+    int32_t * act_sum;
+    int32_t * act_i32;
+};
+
+static void dense_quantize_task(void * ctx, int ith, int nth) {
+    const dense_task * t = (const dense_task *) ctx;
+    const int k = t->w->k;
+    const uint64_t t0 = ggml_bitnet_rt_now_ns();
+    int start, end;
+    ggml_bitnet_rt_partition(ith, nth, t->n, 1, &start, &end);
+    for (int b = start; b < end; b++) {
+        const float * x = t->x + (size_t) b * k;
+        int8_t * q = t->q + (size_t) b * k;
+        float amax = 0.0f;
+        for (int i = 0; i < k; i++) {
+            amax = fmaxf(amax, fabsf(x[i]));
+        }
+        const float s = 127.0f / fmaxf(amax, 1e-5f);
+        int32_t sum = 0;
+        for (int i = 0; i < k; i++) {
+            const float v = nearbyintf(x[i] * s);
+            q[i] = (int8_t) (v > 127.0f ? 127.0f : (v < -128.0f ? -128.0f : v));
+            sum += q[i];
+        }
+        t->act_scale[b] = s;
+        t->act_sum[b] = sum;
+        if (t->act_i32 != nullptr) {
+#if defined(__AVX2__)
+            convert_int8_to_int32_avx2(q, t->act_i32 + (size_t) b * k, k);
+#else
+            convert_int8_to_int32_scalar(q, t->act_i32 + (size_t) b * k, k);
+#endif
+        }
+    }
+    if (end > start) {
+        // float columns in, int8 (and int32) columns out
+        const size_t per_column = (size_t) k * (sizeof(float) + 1 + (t->act_i32 != nullptr ? sizeof(int32_t) : 0));
+        bitnet_kernels_charge((size_t) (end - start) * per_column, t0);
+    }
+}
+
+static void dense_rows_task(void * ctx, int ith, int nth) {
+    const dense_task * t = (const dense_task *) ctx;
+    const bitnet_kernels_weights * w = t->w;
+    const int m = w->m, k = w->k;
+    int start, end;
+    ggml_bitnet_rt_partition(ith, nth, m, 4, &start, &end);
+    // tiles of about 16 KiB of weights, the unit the bandwidth governor paces
+    const int tile_rows = std::max(4, 16384 / (k / 4) / 4 * 4);
+    for (int r0 = start; r0 < end; r0 += tile_rows) {
+        const int r1 = std::min(end, r0 + tile_rows);
+        const uint64_t t0 = ggml_bitnet_rt_now_ns();
+        // rows outer: a weight row stays in cache across the columns
+        for (int r = r0; r < r1; r++) {
+            const uint8_t * row = w->data + (size_t) r * k / 4;
+            for (int b = 0; b < t->n; b++) {
+                float acc;
+                if (w->kind == BITNET_KERNELS_STFMA) {
+                    acc = (float) ggml_bitnet_stfma_dense(row, t->act_i32 + (size_t) b * k, k);
+                } else {
+                    float dot;
+                    ggml_vec_dot_i2_i8_s(k, &dot, 0, row, 0, t->q + (size_t) b * k, 0, 1);
+                    acc = dot - (float) t->act_sum[b];
+                }
+                t->y[(size_t) b * m + r] = acc / t->act_scale[b] * w->scale;
+            }
+        }
+        bitnet_kernels_charge((size_t) (r1 - r0) * (k / 4 + t->n * sizeof(float)), t0);
+    }
+}
+
+void bitnet_kernels_charge(size_t bytes, uint64_t t0_ns) {
+    ggml_bitnet_bw_charge(bytes, ggml_bitnet_rt_now_ns() - t0_ns);
+}
+
+void bitnet_kernels_run_region(const struct bitnet_kernels_exec * exec, bitnet_kernels_task task, void * ctx) {
+    if (exec->parallel_for != nullptr && exec->n_threads > 1) {
+        exec->parallel_for(exec->pool, task, ctx, exec->n_threads);
+        return;
+    }
+    // same partition as the threaded run, so results do not depend on the pool
+    for (int ith = 0; ith < exec->n_threads; ith++) {
+        task(ctx, ith, exec->n_threads);
+    }
+}
+
+struct bitnet_kernels_team {
+    ggml_bitnet_team * team;
+};
+
+struct fused_regions {
+    ggml_bitnet_team * team;
+    const bitnet_kernels_task * tasks;
+    int n_tasks;
+    void * ctx;
+};
+
+static void fused_regions_task(void * ctx, int ith, int nth) {
+    const fused_regions * f = (const fused_regions *) ctx;
+    for (int i = 0; i < f->n_tasks; i++) {
+        if (i > 0) {
+            ggml_bitnet_team_barrier(f->team);
+        }
+        f->tasks[i](f->ctx, ith, nth);
+    }
+}
+
+void bitnet_kernels_run_regions(const struct bitnet_kernels_exec * exec, const bitnet_kernels_task * tasks,
+                                int n_tasks, void * ctx) {
+    if (exec->parallel_for == bitnet_kernels_team_parallel_for && exec->n_threads > 1) {
+        // one fork/join instead of one per region: the regions only depend on each other through the barriers
+        ggml_bitnet_team * team = ((bitnet_kernels_team *) exec->pool)->team;
+        fused_regions f = { team, tasks, n_tasks, ctx };
+        ggml_bitnet_team_run(team, fused_regions_task, &f, exec->n_threads);
+        return;
+    }
+    for (int i = 0; i < n_tasks; i++) {
+        bitnet_kernels_run_region(exec, tasks[i], ctx);
+    }
+}
+
+size_t bitnet_kernels_workspace_size(const bitnet_kernels_weights * w, int n, int n_threads) {
+    (void) n_threads;   // partitions are static, no per-thread scratch
+    if (w == nullptr || n <= 0) {
+        return 0;
+    }
+    const size_t size = w->kind == BITNET_KERNELS_I2_S || w->kind == BITNET_KERNELS_STFMA
+        ? dense_workspace(w, n).size
+        : bitnet_kernels_lut_workspace_size(w, n);
+    // slack to align a caller buffer
+    return size + BITNET_KERNELS_ALIGN;
+}
+
+int bitnet_kernels_gemm(const bitnet_kernels_weights * w, int n, const float * x, float * y,
+                        const struct bitnet_kernels_exec * exec) {
+    if (w == nullptr || n <= 0 || x == nullptr || y == nullptr || exec == nullptr ||
+        exec->struct_size < sizeof(struct bitnet_kernels_exec) || exec->n_threads < 1) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    if (exec->workspace == nullptr || exec->workspace_size < bitnet_kernels_workspace_size(w, n, exec->n_threads)) {
+        return BITNET_KERNELS_ERR_WORKSPACE;
+    }
+    uint8_t * ws = (uint8_t *) align_up((size_t) exec->workspace);
+
+    // under a bandwidth budget, threads past the budget would only wait on the pacer
+    bitnet_kernels_exec governed = *exec;
+    governed.n_threads = ggml_bitnet_bw_threads(exec->n_threads);
+    exec = &governed;
+
+    if (w->kind == BITNET_KERNELS_TL1 || w->kind == BITNET_KERNELS_TL2) {
+        bitnet_kernels_lut_gemm(w, n, x, y, exec, ws);
+        return BITNET_KERNELS_OK;
+    }
+
+    const dense_layout l = dense_workspace(w, n);
+    dense_task t;
+    t.w = w;
+    t.n = n;
+    t.x = x;
+    t.y = y;
+    t.q = (int8_t *) (ws + l.q);
+    t.act_scale = (float *) (ws + l.act_scale);
+    t.act_sum = (int32_t *) (ws + l.act_sum);
+    t.act_i32 = w->kind == BITNET_KERNELS_STFMA ? (int32_t *) (ws + l.act_i32) : nullptr;
+
+    const bitnet_kernels_task tasks[] = { dense_quantize_task, dense_rows_task };
+    bitnet_kernels_run_regions(exec, tasks, 2, &t);
+    return BITNET_KERNELS_OK;
+}
+
+int bitnet_kernels_gemv(const bitnet_kernels_weights * w, const float * x, float * y,
+                        const struct bitnet_kernels_exec * exec) {
+    return bitnet_kernels_gemm(w, 1, x, y, exec);
+}
+
+// memory-bandwidth governor (1.1)
+
+int bitnet_kernels_set_bandwidth_budget(double gbps, int mode) {
+    if (!(gbps >= 0.0) || (mode & ~(BITNET_KERNELS_BW_PACE | BITNET_KERNELS_BW_THREADS)) != 0) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    ggml_bitnet_bw_set_budget(gbps, mode);
+    return BITNET_KERNELS_OK;
+}
+
+int bitnet_kernels_bandwidth_report(struct bitnet_kernels_bandwidth * out, int reset) {
+    if (out == nullptr || out->struct_size < sizeof(struct bitnet_kernels_bandwidth)) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    ggml_bitnet_bw_stats s;
+    ggml_bitnet_bw_get_stats(&s);
+    out->budget_gbps = s.budget_gbps;
+    out->achieved_gbps = s.achieved_gbps;
+    out->thread_gbps = s.thread_gbps;
+    out->bytes = s.bytes;
+    out->elapsed_ns = s.elapsed_ns;
+    out->throttled_ns = s.throttled_ns;
+    if (reset) {
+        ggml_bitnet_bw_reset_stats();
+    }
+    return BITNET_KERNELS_OK;
+}
+
+// persistent worker team (1.2)
+
+int bitnet_kernels_team_create(int n_threads, bitnet_kernels_team ** out) {
+    if (out == nullptr) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    *out = nullptr;
+    if (n_threads < 1) {
+        return BITNET_KERNELS_ERR_INVALID;
+    }
+    bitnet_kernels_team * t = (bitnet_kernels_team *) malloc(sizeof(bitnet_kernels_team));
+    if (t == nullptr) {
+        return BITNET_KERNELS_ERR_NOMEM;
+    }
+    t->team = ggml_bitnet_team_create(n_threads);
+    if (t->team == nullptr) {
+        free(t);
+        return BITNET_KERNELS_ERR_NOMEM;
+    }
+    *out = t;
+    return BITNET_KERNELS_OK;
+}
+
+void bitnet_kernels_team_free(bitnet_kernels_team * team) {
+    if (team == nullptr) {
+        return;
+    }
+    ggml_bitnet_team_free(team->team);
+    free(team);
+}
+
+void bitnet_kernels_team_parallel_for(void * team, bitnet_kernels_task task, void * task_ctx, int nth) {
+    ggml_bitnet_team_run(((bitnet_kernels_team *) team)->team, task, task_ctx, nth);
+}
+
+void bitnet_kernels_team_barrier(bitnet_kernels_team * team) {
+    ggml_bitnet_team_barrier(team->team);
+}
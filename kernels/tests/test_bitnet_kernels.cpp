@@ -0,0 +1,396 @@
+/**
+ * Test for the standalone kernel library
+ *
+ * Goes through the C ABI only: version and capability queries, argument
+ * errors, and every kernel family built in against a scalar ternary
+ * reference, for GEMV and GEMM, for both prepack paths (int8 ternary and
+ * GGUF I2_S bytes), with a threaded parallel for and on a persistent
+ * worker team, plus the team's barrier and the bandwidth governor's
+ * accounting and cap.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <thread>
+#include <cmath>
+#include <cstring>
+
+#include "bitnet-kernels.h"
+#include "ggml-bitnet-pack.h"
+
+static int failures = 0;
+
+#define CHECK(cond, msg) \
+    do { \
+        if (!(cond)) { \
+            std::cout << "  ✗ " << msg << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+static std::mt19937 rng(7);
+static bitnet_kernels_team * team = nullptr;
+
+// parallel for of the caller: one std::thread per task
+static void thread_parallel_for(void * pool, bitnet_kernels_task task, void * task_ctx, int nth) {
+    (void) pool;
+    std::vector<std::thread> threads;
+    for (int ith = 1; ith < nth; ith++) {
+        threads.emplace_back(task, task_ctx, ith, nth);
+    }
+    task(task_ctx, 0, nth);
+    for (auto & t : threads) {
+        t.join();
+    }
+}
+
+struct runner {
+    std::vector<uint8_t> workspace;
+    bitnet_kernels_exec exec;
+
+    runner(const bitnet_kernels_weights * w, int n, int n_threads) {
+        workspace.resize(bitnet_kernels_workspace_size(w, n, n_threads));
+        memset(&exec, 0, sizeof(exec));
+        exec.struct_size = sizeof(exec);
+        exec.parallel_for = n_threads > 1 ? thread_parallel_for : nullptr;
+        exec.n_threads = n_threads;
+        exec.workspace = workspace.data();
+        exec.workspace_size = workspace.size();
+    }
+};
+
+static std::vector<int8_t> random_ternary(size_t n) {
+    std::uniform_int_distribution<int> dist(-1, 1);
+    std::vector<int8_t> w(n);
+    for (auto & v : w) v = (int8_t) dist(rng);
+    return w;
+}
+
+static std::vector<float> random_activations(size_t n) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> x(n);
+    for (auto & v : x) v = dist(rng);
+    return x;
+}
+
+// float reference, y = scale * W x
+static std::vector<float> reference(const std::vector<int8_t> & w, int m, int k, float scale, const std::vector<float> & x, int n) {
+    std::vector<float> y((size_t) n * m);
+    for (int b = 0; b < n; b++) {
+        for (int r = 0; r < m; r++) {
+            double acc = 0.0;
+            for (int i = 0; i < k; i++) {
+                acc += w[(size_t) r * k + i] * (double) x[(size_t) b * k + i];
+            }
+            y[(size_t) b * m + r] = (float) (acc * scale);
+        }
+    }
+    return y;
+}
+
+// relative RMS error of y against ref
+static double rel_error(const std::vector<float> & y, const std::vector<float> & ref) {
+    double err2 = 0.0, ref2 = 0.0;
+    for (size_t i = 0; i < y.size(); i++) {
+        err2 += ((double) y[i] - ref[i]) * ((double) y[i] - ref[i]);
+        ref2 += (double) ref[i] * ref[i];
+    }
+    return sqrt(err2 / ref2);
+}
+
+static void test_version() {
+    std::cout << "Version and capabilities..." << std::endl;
+    CHECK(bitnet_kernels_version() == BITNET_KERNELS_VERSION, "library version differs from the header");
+    CHECK(bitnet_kernels_check_version(BITNET_KERNELS_VERSION) == BITNET_KERNELS_OK, "own header rejected");
+    CHECK(bitnet_kernels_check_version((BITNET_KERNELS_VERSION_MAJOR + 1) << 16) == BITNET_KERNELS_ERR_VERSION,
+          "next major accepted");
+    CHECK(bitnet_kernels_check_version(BITNET_KERNELS_VERSION + 1) == BITNET_KERNELS_ERR_VERSION,
+          "newer minor accepted");
+
+    CHECK(bitnet_kernels_supports(BITNET_KERNELS_I2_S), "I2_S not built");
+    CHECK(bitnet_kernels_supports(BITNET_KERNELS_STFMA), "STFMA not built");
+    CHECK(!bitnet_kernels_supports(BITNET_KERNELS_KIND_COUNT), "unknown kind supported");
+    CHECK(!(bitnet_kernels_supports(BITNET_KERNELS_TL1) && bitnet_kernels_supports(BITNET_KERNELS_TL2)),
+          "TL1 and TL2 both built");
+    CHECK(strcmp(bitnet_kernels_kind_name(BITNET_KERNELS_TL2), "tl2") == 0, "kind name");
+
+    CHECK(bitnet_kernels_supports_shape(BITNET_KERNELS_I2_S, 64, 256), "I2_S 64x256");
+    CHECK(!bitnet_kernels_supports_shape(BITNET_KERNELS_I2_S, 64, 100), "I2_S accepts k % 128 != 0");
+
+    for (int kind : {BITNET_KERNELS_TL1, BITNET_KERNELS_TL2}) {
+        const int n = bitnet_kernels_lut_shapes(kind, nullptr, 0);
+        CHECK((n > 0) == (bitnet_kernels_supports(kind) != 0), bitnet_kernels_kind_name(kind) << " shape count");
+        std::vector<int> shapes(2 * n);
+        bitnet_kernels_lut_shapes(kind, shapes.data(), n);
+        for (int i = 0; i < n; i++) {
+            CHECK(bitnet_kernels_supports_shape(kind, shapes[2 * i], shapes[2 * i + 1]), "listed shape not supported");
+        }
+    }
+    std::cout << "  isa mask " << bitnet_kernels_isa() << std::endl;
+}
+
+static void test_errors() {
+    std::cout << "Argument errors..." << std::endl;
+    const int m = 32, k = 128;
+    std::vector<int8_t> t = random_ternary((size_t) m * k);
+    bitnet_kernels_weights * w = nullptr;
+
+    t[5] = 2;
+    CHECK(bitnet_kernels_prepack(BITNET_KERNELS_I2_S, m, k, t.data(), 1.0f, &w) == BITNET_KERNELS_ERR_INVALID,
+          "non-ternary value accepted");
+    CHECK(w == nullptr, "handle set on failure");
+    t[5] = 1;
+    CHECK(bitnet_kernels_prepack(BITNET_KERNELS_TL2, m, k, t.data(), 1.0f, &w) == BITNET_KERNELS_ERR_UNSUPPORTED,
+          "TL2 accepted a shape without a generated kernel");
+    CHECK(bitnet_kernels_prepack(-1, m, k, t.data(), 1.0f, &w) == BITNET_KERNELS_ERR_INVALID, "bad kind accepted");
+
+    CHECK(bitnet_kernels_prepack(BITNET_KERNELS_I2_S, m, k, t.data(), 1.0f, &w) == BITNET_KERNELS_OK, "prepack");
+    std::vector<float> x(k, 1.0f), y(m);
+    runner run(w, 1, 1);
+    run.exec.workspace_size -= 1;
+    CHECK(bitnet_kernels_gemv(w, x.data(), y.data(), &run.exec) == BITNET_KERNELS_ERR_WORKSPACE, "short workspace accepted");
+    run.exec.workspace_size += 1;
+    run.exec.struct_size = 8;
+    CHECK(bitnet_kernels_gemv(w, x.data(), y.data(), &run.exec) == BITNET_KERNELS_ERR_INVALID, "truncated exec accepted");
+    run.exec.struct_size = sizeof(run.exec);
+    CHECK(bitnet_kernels_gemv(w, x.data(), y.data(), &run.exec) == BITNET_KERNELS_OK, "gemv");
+
+    int kind = -1, wm = 0, wk = 0;
+    size_t bytes = 0;
+    bitnet_kernels_weights_info(w, &kind, &wm, &wk, &bytes);
+    CHECK(kind == BITNET_KERNELS_I2_S && wm == m && wk == k && bytes == (size_t) m * k / 4, "weights info");
+    bitnet_kernels_weights_free(w);
+    bitnet_kernels_weights_free(nullptr);
+}
+
+// one kind and shape: both prepack paths, GEMV vs GEMM, serial vs threaded; returns the GEMM output
+static std::vector<float> test_kernel(int kind, int m, int k, double tolerance) {
+    const char * name = bitnet_kernels_kind_name(kind);
+    const int n = 3;
+    rng.seed(m * 7919u + k);    // same weights and activations for every kind
+    const float scale = 0.37f;
+    std::vector<int8_t> t = random_ternary((size_t) m * k);
+    std::vector<float> x = random_activations((size_t) n * k);
+    std::vector<float> ref = reference(t, m, k, scale, x, n);
+
+    bitnet_kernels_weights * w = nullptr;
+    CHECK(bitnet_kernels_prepack(kind, m, k, t.data(), scale, &w) == BITNET_KERNELS_OK, name << " prepack");
+    if (w == nullptr) {
+        return {};
+    }
+
+    // GEMM on one thread
+    std::vector<float> y((size_t) n * m);
+    runner serial(w, n, 1);
+    CHECK(bitnet_kernels_gemm(w, n, x.data(), y.data(), &serial.exec) == BITNET_KERNELS_OK, name << " gemm");
+    const double err = rel_error(y, ref);
+    CHECK(err < tolerance, name << " " << m << "x" << k << " relative error " << err << " above " << tolerance);
+
+    // the same weights from I2_S bytes (whole 128-blocks only)
+    if (k % 128 == 0) {
+        std::vector<uint8_t> i2(t.size() / 4);
+        ggml_bitnet_pack_i2_s(t.data(), i2.data(), t.size());
+        bitnet_kernels_weights * w_i2 = nullptr;
+        CHECK(bitnet_kernels_prepack_i2_s(kind, m, k, i2.data(), scale, &w_i2) == BITNET_KERNELS_OK, name << " prepack_i2_s");
+        std::vector<float> y_i2((size_t) n * m);
+        CHECK(bitnet_kernels_gemm(w_i2, n, x.data(), y_i2.data(), &serial.exec) == BITNET_KERNELS_OK, name << " gemm i2_s");
+        CHECK(memcmp(y.data(), y_i2.data(), y.size() * sizeof(float)) == 0, name << " I2_S prepack differs");
+        bitnet_kernels_weights_free(w_i2);
+    }
+
+    // GEMV per column
+    for (int b = 0; b < n; b++) {
+        std::vector<float> yv(m);
+        runner one(w, 1, 1);
+        bitnet_kernels_gemv(w, x.data() + (size_t) b * k, yv.data(), &one.exec);
+        CHECK(memcmp(yv.data(), y.data() + (size_t) b * m, m * sizeof(float)) == 0, name << " gemv differs from gemm column " << b);
+    }
+
+    // threaded: identical results
+    for (int nth : {2, 3, 4}) {
+        std::vector<float> yt((size_t) n * m);
+        runner threaded(w, n, nth);
+        CHECK(bitnet_kernels_gemm(w, n, x.data(), yt.data(), &threaded.exec) == BITNET_KERNELS_OK, name << " threaded gemm");
+        CHECK(memcmp(y.data(), yt.data(), y.size() * sizeof(float)) == 0, name << " differs on " << nth << " threads");
+    }
+
+    // persistent team: both regions in one fork, repeated calls on the same workers
+    for (int nth : {2, 4}) {
+        std::vector<float> yt((size_t) n * m);
+        runner on_team(w, n, nth);
+        on_team.exec.parallel_for = bitnet_kernels_team_parallel_for;
+        on_team.exec.pool = team;
+        for (int i = 0; i < 3; i++) {
+            CHECK(bitnet_kernels_gemm(w, n, x.data(), yt.data(), &on_team.exec) == BITNET_KERNELS_OK, name << " team gemm");
+            CHECK(memcmp(y.data(), yt.data(), y.size() * sizeof(float)) == 0, name << " differs on a team of " << nth);
+        }
+    }
+
+    std::cout << "  " << name << " " << m << "x" << k << ": relative error " << err << std::endl;
+    bitnet_kernels_weights_free(w);
+    return y;
+}
+
+static void test_dense() {
+    std::cout << "I2_S and STFMA kernels..." << std::endl;
+    const int shapes[][2] = {{64, 128}, {96, 4224}, {256, 2560}};
+    for (const auto & s : shapes) {
+        // only the int8 activation quantization separates them from the reference
+        std::vector<float> y_i2 = test_kernel(BITNET_KERNELS_I2_S, s[0], s[1], 2e-2);
+        std::vector<float> y_stfma = test_kernel(BITNET_KERNELS_STFMA, s[0], s[1], 2e-2);
+        // same int8 activations and exact integer sums: the two must agree bit for bit
+        CHECK(y_i2 == y_stfma, "I2_S and STFMA differ at " << s[0] << "x" << s[1]);
+    }
+}
+
+static void test_lut() {
+    for (int kind : {BITNET_KERNELS_TL1, BITNET_KERNELS_TL2}) {
+        const int n = bitnet_kernels_lut_shapes(kind, nullptr, 0);
+        if (n == 0) {
+            continue;
+        }
+        std::cout << bitnet_kernels_kind_name(kind) << " kernels..." << std::endl;
+        std::vector<int> shapes(2 * n);
+        bitnet_kernels_lut_shapes(kind, shapes.data(), n);
+        for (int i = 0; i < n; i++) {
+            // activations are quantized per LUT entry
+            test_kernel(kind, shapes[2 * i], shapes[2 * i + 1], 3e-2);
+        }
+    }
+}
+
+struct phase_ctx {
+    std::vector<int> phase;
+    int rounds;
+    bool torn;
+};
+
+// every thread publishes its round, waits at the barrier, then checks all others reached it
+static void phase_task(void * ctx, int ith, int nth) {
+    phase_ctx * p = (phase_ctx *) ctx;
+    for (int r = 0; r < p->rounds; r++) {
+        p->phase[ith] = r;
+        bitnet_kernels_team_barrier(team);
+        for (int j = 0; j < nth; j++) {
+            if (p->phase[j] != r) p->torn = true;
+        }
+        bitnet_kernels_team_barrier(team);
+    }
+}
+
+static void count_task(void * ctx, int ith, int nth) {
+    std::vector<int> * hits = (std::vector<int> *) ctx;
+    (*hits)[ith] += nth;
+}
+
+static void test_team() {
+    std::cout << "Worker team..." << std::endl;
+    bitnet_kernels_team * t = nullptr;
+    CHECK(bitnet_kernels_team_create(0, &t) == BITNET_KERNELS_ERR_INVALID && t == nullptr, "empty team accepted");
+    CHECK(bitnet_kernels_team_create(2, nullptr) == BITNET_KERNELS_ERR_INVALID, "null output accepted");
+    bitnet_kernels_team_free(nullptr);
+
+    // each run reaches exactly threads 0 .. nth - 1, nth clamped to the team size
+    std::vector<int> hits(4, 0);
+    for (int i = 0; i < 1000; i++) {
+        bitnet_kernels_team_parallel_for(team, count_task, &hits, 1 + i % 6);
+    }
+    int expected[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 1000; i++) {
+        const int nth = std::min(4, 1 + i % 6);
+        for (int ith = 0; ith < nth; ith++) expected[ith] += nth;
+    }
+    for (int ith = 0; ith < 4; ith++) {
+        CHECK(hits[ith] == expected[ith], "thread " << ith << " ran " << hits[ith] << " times, expected " << expected[ith]);
+    }
+
+    for (int nth : {2, 3, 4}) {
+        phase_ctx p;
+        p.phase.assign(nth, -1);
+        p.rounds = 200;
+        p.torn = false;
+        bitnet_kernels_team_parallel_for(team, phase_task, &p, nth);
+        CHECK(!p.torn, "barrier let a thread through early on " << nth << " threads");
+    }
+}
+
+static void test_bandwidth() {
+    std::cout << "Bandwidth governor..." << std::endl;
+    CHECK(bitnet_kernels_set_bandwidth_budget(-1.0, BITNET_KERNELS_BW_PACE) == BITNET_KERNELS_ERR_INVALID, "negative budget accepted");
+    CHECK(bitnet_kernels_set_bandwidth_budget(1.0, 4) == BITNET_KERNELS_ERR_INVALID, "unknown mode accepted");
+    bitnet_kernels_bandwidth report;
+    report.struct_size = 8;
+    CHECK(bitnet_kernels_bandwidth_report(&report, 0) == BITNET_KERNELS_ERR_INVALID, "truncated report accepted");
+    report.struct_size = sizeof(report);
+
+    const int m = 1024, k = 2560, calls = 20, n_threads = 4;
+    std::vector<int8_t> t = random_ternary((size_t) m * k);
+    std::vector<float> x = random_activations(k), y_free(m), y_capped(m);
+    bitnet_kernels_weights * w = nullptr;
+    bitnet_kernels_prepack(BITNET_KERNELS_I2_S, m, k, t.data(), 1.0f, &w);
+    runner run(w, 1, n_threads);
+
+    // no budget: bytes are counted (up to the per-thread quantum still pending), nothing is paced
+    bitnet_kernels_set_bandwidth_budget(0.0, 0);
+    bitnet_kernels_bandwidth_report(&report, 1);
+    for (int i = 0; i < calls; i++) {
+        bitnet_kernels_gemv(w, x.data(), y_free.data(), &run.exec);
+    }
+    bitnet_kernels_bandwidth_report(&report, 1);
+    const double weight_bytes = (double) calls * m * k / 4;
+    CHECK(report.bytes >= 0.9 * weight_bytes && report.bytes <= 1.1 * weight_bytes,
+          "charged " << report.bytes << " bytes for " << weight_bytes << " bytes of weights");
+    CHECK(report.throttled_ns == 0 && report.budget_gbps == 0.0, "paced without a budget");
+    CHECK(report.thread_gbps > 0.0, "no per-thread bandwidth estimate");
+
+    // a budget well below what the host streams: achieved stays under it, results do not change
+    const double budget = 0.5;
+    for (int mode : {(int) BITNET_KERNELS_BW_PACE, BITNET_KERNELS_BW_PACE | BITNET_KERNELS_BW_THREADS}) {
+        CHECK(bitnet_kernels_set_bandwidth_budget(budget, mode) == BITNET_KERNELS_OK, "set budget");
+        for (int i = 0; i < calls; i++) {
+            bitnet_kernels_gemv(w, x.data(), y_capped.data(), &run.exec);
+        }
+        bitnet_kernels_bandwidth_report(&report, 1);
+        std::cout << "  mode " << mode << ": " << report.achieved_gbps << " GB/s of " << report.budget_gbps
+                  << " GB/s budget, throttled " << report.throttled_ns / 1000000.0 << " ms" << std::endl;
+        CHECK(report.budget_gbps == budget, "budget not reported");
+        CHECK(report.achieved_gbps <= 1.15 * budget, "achieved " << report.achieved_gbps << " GB/s over budget");
+        CHECK(report.throttled_ns > 0, "never paced");
+        CHECK(y_capped == y_free, "pacing changed the result");
+    }
+
+    // threads only: the next call runs on fewer threads, with the same result
+    bitnet_kernels_set_bandwidth_budget(report.thread_gbps * 1.5, BITNET_KERNELS_BW_THREADS);
+    bitnet_kernels_gemv(w, x.data(), y_capped.data(), &run.exec);
+    CHECK(y_capped == y_free, "thread cap changed the result");
+
+    bitnet_kernels_set_bandwidth_budget(0.0, 0);
+    bitnet_kernels_weights_free(w);
+}
+
+int main() {
+    std::cout << "Standalone Kernel Library Test" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    if (bitnet_kernels_team_create(4, &team) != BITNET_KERNELS_OK) {
+        std::cout << "✗ cannot start a worker team" << std::endl;
+        return 1;
+    }
+
+    test_version();
+    test_errors();
+    test_team();
+    test_dense();
+    test_lut();
+    test_bandwidth();
+    bitnet_kernels_team_free(team);
+
+    if (failures == 0) {
+        std::cout << "\n✓ All tests passed" << std::endl;
+        return 0;
+    }
+    std::cout << "\n✗ " << failures << " checks failed" << std::endl;
+    return 1;
+}
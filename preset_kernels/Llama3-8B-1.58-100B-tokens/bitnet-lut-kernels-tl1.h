@@ -1,4 +1,5 @@
 #if defined(GGML_BITNET_ARM_TL1)
+#if !defined(BITNET_KERNELS_STANDALONE)
 #include "ggml-bitnet.h"
 #define GGML_BITNET_MAX_NODES 8192
 static bool initialized = false;
@@ -20,6 +21,7 @@ static void aligned_free(void * ptr) {{
     free(ptr);
 #endif
 }}
+#endif
 
 void per_tensor_quant(int k, void* lut_scales_, void* b_) {{
     bitnet_float_type* lut_scales = (bitnet_float_type*)lut_scales_;
@@ -171,6 +173,7 @@ inline void lut_ctor(int8_t* qlut, bitnet_float_type* b, bitnet_float_type* lut_
 #endif
 }}
 
+#if !defined(BITNET_KERNELS_STANDALONE)
 static bool is_type_supported(enum ggml_type type) {{
     if (type == GGML_TYPE_Q4_0 ||
         type == GGML_TYPE_TL1) {{
@@ -179,6 +182,7 @@ static bool is_type_supported(enum ggml_type type) {{
         return false;
     }}
 }}
+#endif
 #include <arm_neon.h>
 
 #define BM14336_4096 256
@@ -705,6 +709,21 @@ void ggml_preprocessor(int m, int k, void* B, void* LUT_Scales, void* QLUT) {
         preprocessor_k<4096>(B, LUT_Scales, QLUT);
     }
 }
+void ggml_preprocessor_scales_mt(int ith, int nth, int bs, int k, void* B, void* LUT_Scales) {
+    const int32_t b_start = (int32_t)((int64_t)bs * ith / nth);
+    const int32_t b_end = (int32_t)((int64_t)bs * (ith + 1) / nth);
+    for (int32_t b = b_start; b < b_end; b++) {
+        per_tensor_quant(k, (&(((bitnet_float_type*)LUT_Scales)[b])), (&(((bitnet_float_type*)B)[b * k])));
+    }
+}
+void ggml_preprocessor_mt(int ith, int nth, int k, void* B, void* LUT_Scales, void* QLUT) {
+    const int32_t n_blocks = k / 16;
+    const int32_t blk_start = (int32_t)((int64_t)n_blocks * ith / nth);
+    const int32_t blk_end = (int32_t)((int64_t)n_blocks * (ith + 1) / nth);
+    for (int32_t blk = blk_start; blk < blk_end; blk++) {
+        lut_ctor<16>((&(((int8_t*)QLUT)[blk * 256])), (&(((bitnet_float_type*)B)[blk * 16])), (bitnet_float_type*)LUT_Scales);
+    }
+}
 void ggml_qgemm_lut(int m, int k, void* A, void* LUT, void* Scales, void* LUT_Scales, void* C) {
     if (m == 14336 && k == 4096) {
         qgemm_lut_14336_4096(A, LUT, Scales, LUT_Scales, C);
@@ -720,6 +739,7 @@ void ggml_qgemm_lut(int m, int k, void* A, void* LUT, void* Scales, void* LUT_Sc
     }
 }
 
+#if !defined(BITNET_KERNELS_STANDALONE)
 void ggml_bitnet_transform_tensor(struct ggml_tensor * tensor) {
     if (!(is_type_supported(tensor->type) && tensor->backend == GGML_BACKEND_TYPE_CPU && tensor->extra == nullptr)) {
         return;
@@ -768,4 +788,5 @@ else if (m == 4096 && k == 4096) {
         /* .scales          = */ scales
     };
 }
+#endif
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #if defined(GGML_BITNET_X86_TL2)
+#if !defined(BITNET_KERNELS_STANDALONE)
 #include "ggml-bitnet.h"
 #define GGML_BITNET_MAX_NODES 8192
 static bool initialized = false;
@@ -21,6 +22,7 @@ static void aligned_free(void * ptr) {
     free(ptr);
 #endif
 }
+#endif
 #define BK2 32
 #if defined __AVX2__
 inline void _mm256_merge_epi32(const __m256i v0, const __m256i v1, __m256i *vl, __m256i *vh)
@@ -98,7 +100,7 @@ inline int32_t partial_max_reset(int32_t bs, void* lut_scales_) {
 template<int act_k>
 inline int32_t three_lut_ctor(int8_t* qlut, bitnet_float_type* b, bitnet_float_type* lut_scales) {
 #if defined __AVX2__
-    __m256 vec_lut[16];
+    __m256i vec_lut[16];
     const __m256i vec_bi = _mm256_set_epi32(84, 72, 60, 48, 36, 24, 12, 0);
     float scales = *lut_scales;
     __m256i shuffle_mask = _mm256_set_epi8(
@@ -184,7 +186,7 @@ inline int32_t three_lut_ctor(int8_t* qlut, bitnet_float_type* b, bitnet_float_t
 template<int act_k>
 inline int32_t two_lut_ctor(int8_t* qlut, bitnet_float_type* b, bitnet_float_type* lut_scales) {
 #if defined __AVX2__
-    __m256 vec_lut[16];
+    __m256i vec_lut[16];
     const __m256i vec_bi = _mm256_set_epi32(56, 48, 40, 32, 24, 16, 8, 0);
     float scales = *lut_scales;
     __m256i shuffle_mask = _mm256_set_epi8(
@@ -258,6 +260,7 @@ inline int32_t two_lut_ctor(int8_t* qlut, bitnet_float_type* b, bitnet_float_typ
 #endif
     return 0;
 }
+#if !defined(BITNET_KERNELS_STANDALONE)
 static bool is_type_supported(enum ggml_type type) {
     if (type == GGML_TYPE_Q4_0 ||
         type == GGML_TYPE_TL2) {
@@ -266,6 +269,7 @@ static bool is_type_supported(enum ggml_type type) {
         return false;
     }
 }
+#endif
 #include <immintrin.h>
 
 #define BM3200_8640 160
@@ -1022,6 +1026,35 @@ void ggml_preprocessor(int bs, int m, int three_k, int two_k, void* B, void* LUT
         }
     }
 }
+void ggml_preprocessor_scales_mt(int ith, int nth, int bs, int three_k, int two_k, void* B, void* LUT_Scales) {
+    const int32_t b_start = (int32_t)((int64_t)bs * ith / nth);
+    const int32_t b_end = (int32_t)((int64_t)bs * (ith + 1) / nth);
+    for (int32_t b = b_start; b < b_end; b++) {
+        per_tensor_quant(two_k + three_k, (&(((bitnet_float_type*)LUT_Scales)[b])), (&(((bitnet_float_type*)B)[b * (three_k + two_k)])));
+    }
+}
+void ggml_preprocessor_mt(int ith, int nth, int bs, int three_k, int two_k, void* B, void* LUT_Scales, void* Three_QLUT, void* Two_QLUT) {
+    const int32_t three_blocks = three_k / 24;
+    const int32_t n_blocks = three_blocks + two_k / 16;
+    const int32_t n_chunks = bs >= nth ? 1 : (nth + bs - 1) / bs;
+    const int32_t n_units = bs * n_chunks;
+    const int32_t unit_start = (int32_t)((int64_t)n_units * ith / nth);
+    const int32_t unit_end = (int32_t)((int64_t)n_units * (ith + 1) / nth);
+    for (int32_t u = unit_start; u < unit_end; u++) {
+        const int32_t b = u / n_chunks;
+        const int32_t c = u % n_chunks;
+        const int32_t blk_start = n_blocks * c / n_chunks;
+        const int32_t blk_end = n_blocks * (c + 1) / n_chunks;
+        bitnet_float_type* b_col = (&(((bitnet_float_type*)B)[b * (three_k + two_k)]));
+        bitnet_float_type* lut_scales = (&(((bitnet_float_type*)LUT_Scales)[b]));
+        for (int32_t blk = blk_start; blk < blk_end && blk < three_blocks; blk++) {
+            three_lut_ctor<24>((&(((int8_t*)Three_QLUT)[b * three_k / 3 * 32 + blk * 256])), b_col + blk * 24, lut_scales);
+        }
+        for (int32_t blk = blk_start > three_blocks ? blk_start : three_blocks; blk < blk_end; blk++) {
+            two_lut_ctor<16>((&(((int8_t*)Two_QLUT)[b * two_k / 2 * 32 + (blk - three_blocks) * 256])), b_col + three_k + (blk - three_blocks) * 16, lut_scales);
+        }
+    }
+}
 void ggml_qgemm_lut(int bs, int m, int k, int BK, void* A, void* sign, void* LUT, void* Scales, void* LUT_Scales, void* C) {
     if (m == 3200 && k == 8640) {
         if (BK == 0) {
@@ -1121,6 +1154,7 @@ void ggml_qgemm_lut(int bs, int m, int k, int BK, void* A, void* sign, void* LUT
     }
 }
 
+#if !defined(BITNET_KERNELS_STANDALONE)
 void ggml_bitnet_transform_tensor(struct ggml_tensor * tensor) {
     if (!(is_type_supported(tensor->type) && tensor->backend == GGML_BACKEND_TYPE_CPU && tensor->extra == nullptr)) {
         return;
@@ -1164,4 +1198,5 @@ else if (m == 8640 && k == 3200) {
         /* .scales          = */ scales
     };
 }
+#endif
 #endif
\ No newline at end of file
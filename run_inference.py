@@ -1,8 +1,13 @@
 import os
 import sys
+import json
+import socket
 import signal
+import shutil
 import platform
 import argparse
+import tempfile
+import time
 import subprocess
 
 def run_command(command, shell=False):
@@ -13,16 +18,250 @@ def run_command(command, shell=False):
         print(f"Error occurred while running command: {e}")
         sys.exit(1)
 
-def run_inference():
+def parse_cores(spec):
+    """Parse a core list like '0-3,8' into a list of core ids."""
+    cores = []
+    for part in spec.split(','):
+        if '-' in part:
+            lo, hi = part.split('-')
+            cores.extend(range(int(lo), int(hi) + 1))
+        elif part:
+            cores.append(int(part))
+    return cores
+
+class LatencyHistogram:
+    """Per-token latency histogram in log2 buckets of microseconds, with p50/p90/p99."""
+
+    BUCKETS = 24
+
+    def __init__(self):
+        self.buckets = [0] * self.BUCKETS
+        self.count = 0
+        self.sum_ns = 0
+        self.min_ns = 0
+        self.max_ns = 0
+
+    def record(self, latency_ns):
+        # bucket 0 holds samples below 1 us, bucket i [2^(i-1), 2^i) us, the last one everything above
+        self.buckets[min((latency_ns // 1000).bit_length(), self.BUCKETS - 1)] += 1
+        self.min_ns = latency_ns if self.count == 0 else min(self.min_ns, latency_ns)
+        self.max_ns = max(self.max_ns, latency_ns)
+        self.count += 1
+        self.sum_ns += latency_ns
+
+    def percentile(self, p):
+        """Upper edge of the bucket that holds the percentile, clamped to the observed maximum."""
+        if self.count == 0:
+            return 0
+        target = min(max(int(p / 100.0 * self.count + 0.5), 1), self.count)
+        seen = 0
+        for i, n in enumerate(self.buckets):
+            seen += n
+            if seen >= target:
+                return min((1 << i) * 1000, self.max_ns)
+        return self.max_ns
+
+    def print(self, out=sys.stderr):
+        if self.count == 0:
+            print("token latency: no samples", file=out)
+            return
+        print(f"token latency ({self.count} tokens): mean {self.sum_ns / self.count / 1000:.1f} us, "
+              f"min {self.min_ns / 1000:.1f} us, p50 <= {self.percentile(50) / 1000:.1f} us, "
+              f"p90 <= {self.percentile(90) / 1000:.1f} us, p99 <= {self.percentile(99) / 1000:.1f} us, "
+              f"max {self.max_ns / 1000:.1f} us", file=out)
+        peak = max(self.buckets)
+        for i, n in enumerate(self.buckets):
+            if n:
+                lo = 0 if i == 0 else 1 << (i - 1)
+                print(f"  {lo:8d} - {1 << i:8d} us | {'#' * (40 * n // peak):<40} {n}", file=out)
+
+def binary_path(name):
     build_dir = "build"
     if platform.system() == "Windows":
-        main_path = os.path.join(build_dir, "bin", "Release", "llama-cli.exe")
-        if not os.path.exists(main_path):
-            main_path = os.path.join(build_dir, "bin", "llama-cli")
-    else:
-        main_path = os.path.join(build_dir, "bin", "llama-cli")
+        path = os.path.join(build_dir, "bin", "Release", f"{name}.exe")
+        if os.path.exists(path):
+            return path
+    return os.path.join(build_dir, "bin", name)
+
+def start_local_server(cores, threads, extra_args=None, slot_dir=None):
+    """Start a one-slot llama-server on a free local port, logging to a temporary file."""
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "utils"))
+    from disagg_server import ServerPool
+
+    with socket.socket() as sock:
+        sock.bind(("127.0.0.1", 0))
+        port = sock.getsockname()[1]
+    pool = ServerPool("local", binary_path("llama-server"), args.model, cores, threads, 1, args.ctx_size,
+                      512, 512, port, slot_dir, ['--temp', str(args.temperature)] + (extra_args or []))
+    log_path = os.path.join(tempfile.gettempdir(), f"bitnet-server-{os.getpid()}.log")
+    pool.start(log_path, new_session=True)
+    try:
+        pool.wait_ready()
+    except RuntimeError as e:
+        pool.stop()
+        print(f"Error occurred while starting llama-server: {e}, see {log_path}")
+        sys.exit(1)
+    return pool
+
+def stream_tokens(pool, path, payload):
+    """
+    Yield (text, latency_ns) for every token of a streamed /completion or chat request.
+
+    llama-server sends one event per token. The latency comes from the server's
+    per-token timings when it reports them, else from the gap between events.
+    It is None for the first token, whose time is prompt evaluation.
+    """
+    payload = dict(payload, stream=True, timings_per_token=True)
+    prev_ms = prev_ns = None
+    with pool.request(path, payload) as resp:
+        for line in resp:
+            if not line.startswith(b"data: "):
+                continue
+            data = line[6:].strip()
+            if data == b"[DONE]":
+                break
+            now = time.perf_counter_ns()
+            event = json.loads(data)
+            if "choices" in event:
+                choice = event["choices"][0] if event["choices"] else {}
+                text = (choice.get("delta") or {}).get("content") or ""
+                done = choice.get("finish_reason") is not None
+            else:
+                text = event.get("content", "")
+                done = event.get("stop", False)
+            if done and not text:
+                # the closing event only carries the summary
+                break
+            ms = (event.get("timings") or {}).get("predicted_ms")
+            if ms is not None and prev_ms is not None:
+                latency = int((ms - prev_ms) * 1e6)
+            else:
+                latency = now - prev_ns if prev_ns is not None else None
+            prev_ms, prev_ns = ms, now
+            yield text, latency
+            if done:
+                break
+
+def generate(pool, path, payload, hist):
+    """Stream one reply to stdout and return its text; --realtime records its token times."""
+    pieces = []
+    for i, (text, latency) in enumerate(stream_tokens(pool, path, payload)):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+        pieces.append(text)
+        # the first tokens still warm caches and clocks
+        if args.realtime and latency is not None and i >= args.skip_tokens:
+            hist.record(latency)
+    print()
+    return "".join(pieces)
+
+def chat(pool, messages, hist):
+    """Chat on slot 0: the slot keeps the KV cache of the history, each turn only evaluates its new messages."""
+    while True:
+        try:
+            user = input("> ")
+        except EOFError:
+            break
+        if not user.strip():
+            continue
+        messages.append({"role": "user", "content": user})
+        payload = {"messages": messages, "max_tokens": args.n_predict, "temperature": args.temperature,
+                   "id_slot": 0, "cache_prompt": True}
+        reply = ""
+        try:
+            reply = generate(pool, "/v1/chat/completions", payload, hist)
+        finally:
+            # an interrupted turn keeps what was generated, the slot holds those tokens too
+            if reply:
+                messages.append({"role": "assistant", "content": reply})
+            else:
+                messages.pop()
+
+def restore_server_session(pool, slot_dir, messages):
+    """Restore --session into slot 0 when it matches. Returns where to save the session and the history."""
+    import session_snapshot
+
+    if not os.path.exists(args.session):
+        return args.session, messages
+    try:
+        _, meta = session_snapshot.read_meta(args.session)
+        ok, reason = session_snapshot.check_resume(meta, args.model, None if messages else args.prompt,
+                                                   messages, kind="slot")
+        if ok:
+            start = time.perf_counter()
+            ok, reason, _, _ = session_snapshot.restore_slot(pool.url, 0, slot_dir, args.session,
+                                                             None if messages else args.prompt)
+            if ok:
+                reason += f" in {(time.perf_counter() - start) * 1000:.1f} ms"
+    except ValueError as e:
+        ok, reason = False, str(e)
+    print(f"Session {args.session}: {reason}", file=sys.stderr)
+    if not ok:
+        # a snapshot of another model or conversation is kept, the new one goes beside it
+        target = session_snapshot.sibling_path(args.session)
+        print(f"Session will be saved to {target}", file=sys.stderr)
+        return target, messages
+    if messages is not None and len(meta.get("messages", [])) > len(messages):
+        messages = meta["messages"]
+        print(f"Resumed {len(messages) - 1} messages", file=sys.stderr)
+    return args.session, messages
+
+def run_on_server():
+    """
+    Run on a local llama-server: --realtime decode pinned to --cores, and
+    -cnv chat with --session. Sessions are saved and restored through the server's slot 0,
+    which holds the whole conversation, not just the first prompt.
+    """
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "utils"))
+    import session_snapshot
+
+    cores = parse_cores(args.cores) if args.realtime else []
+    # one thread per pinned core, weights locked in RAM so decode never page-faults
+    threads = len(cores) if args.realtime else args.threads
+    state_dir = "/dev/shm" if os.path.isdir("/dev/shm") else tempfile.gettempdir()
+    slot_dir = tempfile.mkdtemp(prefix="bitnet-slots-", dir=state_dir) if args.session else None
+    pool = start_local_server(cores, threads, ['--mlock'] if args.realtime else [], slot_dir)
+    hist = LatencyHistogram()
+    messages = [{"role": "system", "content": args.prompt}] if args.conversation else None
+    target = args.session
+    try:
+        if args.session:
+            target, messages = restore_server_session(pool, slot_dir, messages)
+        if args.conversation:
+            chat(pool, messages, hist)
+        else:
+            payload = {"prompt": args.prompt, "n_predict": args.n_predict, "temperature": args.temperature,
+                       "id_slot": 0, "cache_prompt": True}
+            generate(pool, "/completion", payload, hist)
+    finally:
+        try:
+            if args.session and pool.process.poll() is None:
+                meta = session_snapshot.model_identity(args.model)
+                meta["prompt"] = args.prompt
+                if messages is not None:
+                    meta["messages"] = messages
+                session_snapshot.save_slot(pool.url, 0, slot_dir, target, meta, args.session_codec)
+                print(f"Session saved to {target}", file=sys.stderr)
+        finally:
+            pool.stop()
+            if slot_dir:
+                shutil.rmtree(slot_dir, ignore_errors=True)
+            if args.realtime:
+                hist.print()
+
+def apply_bandwidth_budget():
+    """Cap the BitNet kernels' DRAM bandwidth; the governor in ggml-bitnet-bandwidth.cpp reads these at startup."""
+    if args.bw_budget > 0:
+        os.environ["BITNET_BW_BUDGET_GBPS"] = str(args.bw_budget)
+        os.environ["BITNET_BW_REPORT"] = "1"
+
+def run_inference():
+    apply_bandwidth_budget()
+    if args.realtime or (args.conversation and args.session):
+        run_on_server()
+        return
     command = [
-        f'{main_path}',
+        binary_path("llama-cli"),
         '-m', args.model,
         '-n', str(args.n_predict),
         '-t', str(args.threads),
@@ -34,8 +273,48 @@ def run_inference():
     ]
     if args.conversation:
         command.append("-cnv")
+    if args.session:
+        run_with_session(command)
+        return
     run_command(command)
 
+def run_with_session(command):
+    """Restore a session snapshot into a llama-cli prompt cache, run, then snapshot the updated cache."""
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "utils"))
+    import session_snapshot
+
+    state_dir = "/dev/shm" if os.path.isdir("/dev/shm") else tempfile.gettempdir()
+    state_path = os.path.join(state_dir, f"bitnet-session-{os.getpid()}.bin")
+    target = args.session
+    if os.path.exists(args.session):
+        try:
+            _, meta = session_snapshot.read_meta(args.session)
+            ok, reason = session_snapshot.check_resume(meta, args.model, args.prompt, kind="prompt-cache")
+        except ValueError as e:
+            ok, reason = False, str(e)
+        print(f"Session {args.session}: {reason}", file=sys.stderr)
+        if ok:
+            start = time.perf_counter()
+            session_snapshot.unpack(args.session, state_path)
+            print(f"Session restored in {(time.perf_counter() - start) * 1000:.1f} ms", file=sys.stderr)
+        else:
+            # a snapshot of another model or prompt is kept, the new one goes beside it
+            target = session_snapshot.sibling_path(args.session)
+            print(f"Session will be saved to {target}", file=sys.stderr)
+
+    command.extend(['--prompt-cache', state_path, '--prompt-cache-all'])
+    try:
+        run_command(command)
+    finally:
+        if os.path.exists(state_path) and os.path.getsize(state_path) > 0:
+            meta = session_snapshot.model_identity(args.model)
+            meta["prompt"] = args.prompt
+            meta["kind"] = "prompt-cache"
+            session_snapshot.pack(state_path, target, meta, args.session_codec)
+            print(f"Session saved to {target}", file=sys.stderr)
+        if os.path.exists(state_path):
+            os.remove(state_path)
+
 def signal_handler(sig, frame):
     print("Ctrl+C pressed, exiting...")
     sys.exit(0)
@@ -51,6 +330,12 @@ if __name__ == "__main__":
     parser.add_argument("-c", "--ctx-size", type=int, help="Size of the prompt context", required=False, default=2048)
     parser.add_argument("-temp", "--temperature", type=float, help="Temperature, a hyperparameter that controls the randomness of the generated text", required=False, default=0.8)
     parser.add_argument("-cnv", "--conversation", action='store_true', help="Whether to enable chat mode or not (for instruct models.)")
+    parser.add_argument("--realtime", action='store_true', help="Low-jitter decode: run llama-server pinned to --cores with locked memory and report per-token latency")
+    parser.add_argument("--cores", type=str, help="Cores used in realtime mode, e.g. 2-3 (one thread per core)", required=False, default="0-1")
+    parser.add_argument("--session", type=str, help="Session snapshot file, restored before and updated after the run", required=False)
+    parser.add_argument("--session-codec", type=str, choices=["zlib", "none"], help="Session snapshot compression (none keeps it mmappable)", required=False, default="zlib")
+    parser.add_argument("--skip-tokens", type=int, help="Warm-up tokens excluded from the latency report", required=False, default=2)
+    parser.add_argument("--bw-budget", type=float, help="Memory-bandwidth budget of the BitNet kernels in GB/s (0: uncapped)", required=False, default=0)
 
     args = parser.parse_args()
     run_inference()
\ No newline at end of file
@@ -1,5 +1,6 @@
 import os
 import sys
+import json
 import signal
 import platform
 import argparse
@@ -13,6 +14,36 @@ def run_command(command, shell=False):
         print(f"Error occurred while running command: {e}")
         sys.exit(1)
 
+def run_self_test(build_dir):
+    """Run bitnet-selftest and return its JSON health report."""
+    if platform.system() == "Windows":
+        selftest_path = os.path.join(build_dir, "bin", "Release", "bitnet-selftest.exe")
+        if not os.path.exists(selftest_path):
+            selftest_path = os.path.join(build_dir, "bin", "bitnet-selftest")
+    else:
+        selftest_path = os.path.join(build_dir, "bin", "bitnet-selftest")
+
+    if not os.path.exists(selftest_path):
+        return {"status": "unhealthy", "checks": [{"name": "selftest", "status": "fail", "detail": f"{selftest_path} not found"}]}
+    result = subprocess.run([selftest_path], capture_output=True, text=True)
+    try:
+        return json.loads(result.stdout)
+    except json.JSONDecodeError:
+        return {"status": "unhealthy", "checks": [{"name": "selftest", "status": "fail", "detail": f"self-test crashed with code {result.returncode}"}]}
+
+def check_health(build_dir):
+    report = run_self_test(build_dir)
+    if args.health_report:
+        with open(args.health_report, "w") as f:
+            json.dump(report, f, indent=2)
+    print(f"Host self-test: {report['status']}")
+    for check in report["checks"]:
+        if check["status"] != "pass":
+            print(f"  [{check['status']}] {check['name']}: {check['detail']}")
+    if args.require_healthy and report["status"] == "unhealthy":
+        print("Refusing to serve on an unhealthy host")
+        sys.exit(1)
+
 def run_server():
     build_dir = "build"
     if platform.system() == "Windows":
@@ -21,6 +52,26 @@ def run_server():
             server_path = os.path.join(build_dir, "bin", "llama-server")
     else:
         server_path = os.path.join(build_dir, "bin", "llama-server")
+
+    if args.self_test or args.require_healthy:
+        check_health(build_dir)
+
+    if args.bw_budget > 0:
+        # read by the bandwidth governor of every llama-server started from here, including disaggregated ones
+        os.environ["BITNET_BW_BUDGET_GBPS"] = str(args.bw_budget)
+        os.environ["BITNET_BW_REPORT"] = "1"
+
+    if args.disaggregate:
+        sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "utils"))
+        from disagg_server import run_disaggregated
+        run_disaggregated(args, server_path)
+        return
+
+    if args.slo:
+        sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "utils"))
+        from slo_server import run_slo
+        run_slo(args, server_path)
+        return
     
     command = [
         f'{server_path}',
@@ -37,6 +88,11 @@ def run_server():
     
     if args.prompt:
         command.extend(['-p', args.prompt])
+
+    if args.slot_save_path:
+        # enables /slots/{id}?action=save|restore, utils/session_snapshot.py packs the saved files
+        os.makedirs(args.slot_save_path, exist_ok=True)
+        command.extend(['--slot-save-path', args.slot_save_path])
     
     # Note: -cnv flag is removed as it's not supported by the server
     
@@ -59,6 +115,28 @@ if __name__ == "__main__":
     parser.add_argument("--temperature", type=float, help="Temperature for sampling", required=False, default=0.8)
     parser.add_argument("--host", type=str, help="IP address to listen on", required=False, default="127.0.0.1")
     parser.add_argument("--port", type=int, help="Port to listen on", required=False, default=8080)
+    parser.add_argument("--self-test", action='store_true', help="Run the host self-test and print the health report before serving")
+    parser.add_argument("--require-healthy", action='store_true', help="Run the host self-test and refuse to serve if the host is unhealthy")
+    parser.add_argument("--health-report", type=str, help="Write the self-test JSON report to this file", required=False)
+    parser.add_argument("--slot-save-path", type=str, help="Directory for saving and restoring slot state (server sessions)", required=False)
+    parser.add_argument("--disaggregate", action='store_true', help="Run prefill and decode in separate servers on disjoint cores")
+    parser.add_argument("--prefill-cores", type=str, help="Cores for the prefill server, e.g. 0-3", required=False, default="0-1")
+    parser.add_argument("--decode-cores", type=str, help="Cores for the decode server, e.g. 4-7", required=False, default="2-3")
+    parser.add_argument("--prefill-threads", type=int, help="Prefill server threads (default: number of prefill cores)", required=False, default=0)
+    parser.add_argument("--decode-threads", type=int, help="Decode server threads (default: number of decode cores)", required=False, default=0)
+    parser.add_argument("--prefill-model", type=str, help="Model file for prefill, e.g. a TL2 gguf (default: --model)", required=False)
+    parser.add_argument("--prefill-batch-size", type=int, help="Batch size for prompt evaluation", required=False, default=512)
+    parser.add_argument("--prefill-slots", type=int, help="Number of prompts evaluated concurrently", required=False, default=1)
+    parser.add_argument("--decode-slots", type=int, help="Number of sequences decoded concurrently", required=False, default=4)
+    parser.add_argument("--slot-dir", type=str, help="Directory for prefill to decode slot handoff", required=False, default="/dev/shm/bitnet-slots")
+    parser.add_argument("--slo", action='store_true', help="Schedule requests by priority class with TTFT/TPOT targets")
+    parser.add_argument("--slo-classes", type=str, help="JSON file of priority classes: {name: {rank, ttft_ms, tpot_ms}}", required=False)
+    parser.add_argument("--slots", type=int, help="Number of sequences decoded concurrently with --slo", required=False, default=4)
+    parser.add_argument("--slo-reserve", type=int, help="Slots only the highest priority class may take", required=False, default=1)
+    parser.add_argument("--prefill-chunk-min", type=int, help="Smallest prefill chunk in tokens with --slo", required=False, default=64)
+    parser.add_argument("--bw-budget", type=float, help="Memory-bandwidth budget of the BitNet kernels in GB/s (0: uncapped)", required=False, default=0)
     
     args = parser.parse_args()
+    if args.slo and args.disaggregate:
+        parser.error("--slo and --disaggregate cannot be combined")
     run_server()
@@ -0,0 +1,7 @@
+// Startup host self-test, prints the JSON health report and exits with its status:
+// 0 healthy, 1 degraded, 2 unhealthy
+#include "ggml-bitnet-selftest.h"
+
+int main(void) {
+    return (int)ggml_bitnet_selftest(stdout);
+}
@@ -0,0 +1,210 @@
+/**
+ * BitNet Memory-Bandwidth Governor - Implementation
+ *
+ * Licensed under the Apache License, Version 2.0
+ */
+
+#include "ggml-bitnet-bandwidth.h"
+#include "ggml-bitnet-realtime.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+
+// bytes per nanosecond is GB/s, so the budget is kept as bytes per ns
+static std::atomic<double> g_bw_budget(0.0);
+static std::atomic<int> g_bw_mode(GGML_BITNET_BW_PACE | GGML_BITNET_BW_THREADS);
+
+// GCRA: the time at which every byte reserved so far has been paid for
+static std::atomic<uint64_t> g_bw_tat(0);
+
+static std::atomic<uint64_t> g_bw_bytes(0);
+static std::atomic<uint64_t> g_bw_weight_only_bytes(0);
+static std::atomic<uint64_t> g_bw_first_ns(0);
+static std::atomic<uint64_t> g_bw_last_ns(0);
+static std::atomic<uint64_t> g_bw_throttled_ns(0);
+static std::atomic<uint64_t> g_bw_throttle_events(0);
+static std::atomic<double> g_bw_thread_rate(0.0);
+
+struct bw_pending {
+    uint64_t bytes;
+    uint64_t weight_only_bytes;
+    uint64_t busy_bytes;
+    uint64_t busy_ns;
+};
+
+static thread_local bw_pending tl_pending = { 0, 0, 0, 0 };
+
+// per-row charges are skipped unless a budget or the exit report needs them
+int ggml_bitnet_bw_enabled = 0;
+static bool g_bw_report = false;
+
+static void bw_update_enabled(void) {
+    __atomic_store_n(&ggml_bitnet_bw_enabled, g_bw_budget.load(std::memory_order_relaxed) > 0.0 || g_bw_report,
+                     __ATOMIC_RELAXED);
+}
+
+/* ========================================================================== */
+/* Configuration                                                              */
+/* ========================================================================== */
+
+static void bw_report_at_exit(void) {
+    ggml_bitnet_bw_print(stderr);
+}
+
+// an unmodified host program (llama-cli, llama-server) is configured through the environment
+static bool bw_init_from_env(void) {
+    const char* budget = getenv("BITNET_BW_BUDGET_GBPS");
+    if (budget != NULL && atof(budget) > 0.0) {
+        ggml_bitnet_bw_set_budget(atof(budget), GGML_BITNET_BW_PACE | GGML_BITNET_BW_THREADS);
+    }
+    const char* report = getenv("BITNET_BW_REPORT");
+    if (report != NULL && strcmp(report, "0") != 0) {
+        g_bw_report = true;
+        bw_update_enabled();
+        atexit(bw_report_at_exit);
+    }
+    return true;
+}
+
+[[maybe_unused]] static const bool g_bw_env_init = bw_init_from_env();
+
+void ggml_bitnet_bw_set_budget(double gbps, int mode) {
+    g_bw_mode.store(mode, std::memory_order_relaxed);
+    g_bw_tat.store(0, std::memory_order_relaxed);
+    g_bw_budget.store(gbps > 0.0 ? gbps : 0.0, std::memory_order_release);
+    bw_update_enabled();
+}
+
+double ggml_bitnet_bw_budget(void) {
+    return g_bw_budget.load(std::memory_order_acquire);
+}
+
+/* ========================================================================== */
+/* Charging and Pacing                                                        */
+/* ========================================================================== */
+
+static void bw_pace(uint64_t bytes, double budget, uint64_t now) {
+    const uint64_t cost = (uint64_t)((double)bytes / budget);
+
+    // reserve [start, start + cost) on the shared timeline; an idle bucket restarts at now
+    uint64_t tat = g_bw_tat.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = (tat > now ? tat : now) + cost;
+    } while (!g_bw_tat.compare_exchange_weak(tat, next, std::memory_order_relaxed));
+
+    if (next > now + GGML_BITNET_BW_BURST_NS) {
+        const uint64_t wait = next - GGML_BITNET_BW_BURST_NS - now;
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+        g_bw_throttled_ns.fetch_add(ggml_bitnet_rt_now_ns() - now, std::memory_order_relaxed);
+        g_bw_throttle_events.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void bw_flush(bw_pending* p) {
+    const uint64_t now = ggml_bitnet_rt_now_ns();
+    g_bw_bytes.fetch_add(p->bytes, std::memory_order_relaxed);
+    g_bw_weight_only_bytes.fetch_add(p->weight_only_bytes, std::memory_order_relaxed);
+    uint64_t first = 0;
+    g_bw_first_ns.compare_exchange_strong(first, now, std::memory_order_relaxed);
+    g_bw_last_ns.store(now, std::memory_order_relaxed);
+
+    if (p->busy_ns > 0) {
+        // moving average of the unthrottled per-thread rate; a lost update between threads is harmless
+        const double rate = (double)p->busy_bytes / (double)p->busy_ns;
+        const double old = g_bw_thread_rate.load(std::memory_order_relaxed);
+        g_bw_thread_rate.store(old == 0.0 ? rate : 0.9 * old + 0.1 * rate, std::memory_order_relaxed);
+    }
+
+    const double budget = g_bw_budget.load(std::memory_order_acquire);
+    if (budget > 0.0 && (g_bw_mode.load(std::memory_order_relaxed) & GGML_BITNET_BW_PACE)) {
+        bw_pace(p->bytes, budget, now);
+    }
+    p->bytes = 0;
+    p->weight_only_bytes = 0;
+    p->busy_bytes = 0;
+    p->busy_ns = 0;
+}
+
+void ggml_bitnet_bw_charge(size_t bytes, uint64_t busy_ns) {
+    bw_pending* p = &tl_pending;
+    p->bytes += bytes;
+    if (busy_ns > 0) {
+        p->busy_bytes += bytes;
+        p->busy_ns += busy_ns;
+    }
+    if (p->bytes >= GGML_BITNET_BW_QUANTUM) {
+        bw_flush(p);
+    }
+}
+
+void ggml_bitnet_bw_charge_weights(size_t bytes) {
+    tl_pending.weight_only_bytes += bytes;
+    ggml_bitnet_bw_charge(bytes, 0);
+}
+
+int ggml_bitnet_bw_threads(int nth) {
+    const double budget = g_bw_budget.load(std::memory_order_acquire);
+    const double rate = g_bw_thread_rate.load(std::memory_order_relaxed);
+    if (nth <= 1 || budget <= 0.0 || rate <= 0.0 ||
+        !(g_bw_mode.load(std::memory_order_relaxed) & GGML_BITNET_BW_THREADS)) {
+        return nth < 1 ? 1 : nth;
+    }
+    // enough threads to reach the budget, the pacer trims the rest
+    const int want = (int)(budget / rate) + 1;
+    return want < 1 ? 1 : (want > nth ? nth : want);
+}
+
+/* ========================================================================== */
+/* Report                                                                     */
+/* ========================================================================== */
+
+void ggml_bitnet_bw_get_stats(struct ggml_bitnet_bw_stats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->budget_gbps = g_bw_budget.load(std::memory_order_acquire);
+    stats->mode = g_bw_mode.load(std::memory_order_relaxed);
+    stats->bytes = g_bw_bytes.load(std::memory_order_relaxed);
+    stats->weight_only_bytes = g_bw_weight_only_bytes.load(std::memory_order_relaxed);
+    const uint64_t first = g_bw_first_ns.load(std::memory_order_relaxed);
+    const uint64_t last = g_bw_last_ns.load(std::memory_order_relaxed);
+    stats->elapsed_ns = first != 0 && last > first ? last - first : 0;
+    stats->achieved_gbps = stats->elapsed_ns > 0 ? (double)stats->bytes / (double)stats->elapsed_ns : 0.0;
+    stats->throttled_ns = g_bw_throttled_ns.load(std::memory_order_relaxed);
+    stats->throttle_events = g_bw_throttle_events.load(std::memory_order_relaxed);
+    stats->thread_gbps = g_bw_thread_rate.load(std::memory_order_relaxed);
+}
+
+void ggml_bitnet_bw_reset_stats(void) {
+    g_bw_bytes.store(0, std::memory_order_relaxed);
+    g_bw_weight_only_bytes.store(0, std::memory_order_relaxed);
+    g_bw_first_ns.store(0, std::memory_order_relaxed);
+    g_bw_last_ns.store(0, std::memory_order_relaxed);
+    g_bw_throttled_ns.store(0, std::memory_order_relaxed);
+    g_bw_throttle_events.store(0, std::memory_order_relaxed);
+}
+
+void ggml_bitnet_bw_print(FILE* out) {
+    struct ggml_bitnet_bw_stats s;
+    ggml_bitnet_bw_get_stats(&s);
+    if (s.bytes == 0) {
+        fprintf(out, "bandwidth: no traffic charged\n");
+        return;
+    }
+    if (s.budget_gbps > 0.0) {
+        fprintf(out, "bandwidth: %.2f GB/s achieved of %.2f GB/s budget (%.0f%%), %.1f MB in %.1f ms\n",
+                s.achieved_gbps, s.budget_gbps, 100.0 * s.achieved_gbps / s.budget_gbps,
+                (double)s.bytes / 1e6, (double)s.elapsed_ns / 1e6);
+        fprintf(out, "  throttled %.1f ms over %llu pauses, one thread streams %.2f GB/s\n",
+                (double)s.throttled_ns / 1e6, (unsigned long long)s.throttle_events, s.thread_gbps);
+    } else {
+        fprintf(out, "bandwidth: %.2f GB/s achieved, no budget, %.1f MB in %.1f ms\n",
+                s.achieved_gbps, (double)s.bytes / 1e6, (double)s.elapsed_ns / 1e6);
+    }
+    if (s.weight_only_bytes > 0) {
+        fprintf(out, "  %.1f MB of it from the per-row ggml kernels, packed weights only (activations not counted)\n",
+                (double)s.weight_only_bytes / 1e6);
+    }
+}
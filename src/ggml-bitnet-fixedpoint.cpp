@@ -0,0 +1,430 @@
+/**
+ * BitNet Integer-Domain Inter-Layer Pipeline - Implementation
+ *
+ * Licensed under the Apache License, Version 2.0
+ */
+
+#include "ggml-bitnet-fixedpoint.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+extern "C" void ggml_vec_dot_i2_i8_s(int n, float * s, size_t bs, const void * vx, size_t bx, const void * vy, size_t by, int nrc);
+
+/* ========================================================================== */
+/* Scales                                                                     */
+/* ========================================================================== */
+
+// m * 2^(e - 31) with m renormalized to [2^30, 2^31)
+static inline ggml_bitnet_fx_scale fx_make(uint64_t m, int e) {
+    if (m == 0) {
+        return {0, 0};
+    }
+    const int shift = (63 - __builtin_clzll(m)) - 30;
+    if (shift > 0) {
+        m = (m + (1ULL << (shift - 1))) >> shift;
+        e += shift;
+        if (m >> 31) {
+            m >>= 1;
+            e++;
+        }
+    } else {
+        m <<= -shift;
+        e += shift;
+    }
+    return {(int32_t)m, e};
+}
+
+// number of significant bits of a positive value
+static inline int fx_bits(uint32_t v) {
+    return v == 0 ? 0 : 32 - __builtin_clz(v);
+}
+
+// right shift that leaves 15 significant bits of amax
+static inline int fx_shift15(uint32_t amax) {
+    const int bits = fx_bits(amax);
+    return bits > 15 ? bits - 15 : 0;
+}
+
+static inline uint32_t fx_absmax_i32(const int32_t* x, int n) {
+    int i = 0;
+    uint32_t amax = 0;
+#if defined(__AVX2__)
+    __m256i vmax = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        vmax = _mm256_max_epu32(vmax, _mm256_abs_epi32(_mm256_loadu_si256((const __m256i*)(x + i))));
+    }
+    uint32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, vmax);
+    for (int j = 0; j < 8; j++) {
+        amax = std::max(amax, lanes[j]);
+    }
+#endif
+    for (; i < n; i++) {
+        amax = std::max(amax, (uint32_t)std::abs((int64_t)x[i]));
+    }
+    return amax;
+}
+
+ggml_bitnet_fx_scale ggml_bitnet_fx_scale_from_float(double f) {
+    if (!(f > 0.0)) {
+        return {0, 0};
+    }
+    int e;
+    const double fr = frexp(f, &e);
+    return fx_make((uint64_t)llround(ldexp(fr, 31)), e);
+}
+
+double ggml_bitnet_fx_scale_to_float(ggml_bitnet_fx_scale s) {
+    return ldexp((double)s.m, s.e - 31);
+}
+
+ggml_bitnet_fx_scale ggml_bitnet_fx_scale_mul(ggml_bitnet_fx_scale a, ggml_bitnet_fx_scale b) {
+    if (a.m == 0 || b.m == 0) {
+        return {0, 0};
+    }
+    return fx_make((uint64_t)a.m * (uint64_t)b.m, a.e + b.e - 31);
+}
+
+/* ========================================================================== */
+/* Quantization                                                               */
+/* ========================================================================== */
+
+int32_t ggml_bitnet_fx_quantize_f32(const float* x, int n, int8_t* q, ggml_bitnet_fx_scale* s) {
+    float amax = 0.0f;
+    for (int i = 0; i < n; i++) {
+        amax = std::max(amax, fabsf(x[i]));
+    }
+    if (amax == 0.0f) {
+        memset(q, 0, n);
+        *s = {0, 0};
+        return 0;
+    }
+    const float iscale = 127.0f / amax;
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        const int v = (int)nearbyintf(x[i] * iscale);
+        q[i] = (int8_t)std::min(127, std::max(-127, v));
+        sum += q[i];
+    }
+    *s = ggml_bitnet_fx_scale_from_float((double)amax / 127.0);
+    return sum;
+}
+
+void ggml_bitnet_fx_quantize_i16(const float* x, int n, int16_t* q, ggml_bitnet_fx_scale* s) {
+    float amax = 0.0f;
+    for (int i = 0; i < n; i++) {
+        amax = std::max(amax, fabsf(x[i]));
+    }
+    if (amax == 0.0f) {
+        memset(q, 0, n * sizeof(int16_t));
+        *s = {0, 0};
+        return;
+    }
+    const float iscale = 32767.0f / amax;
+    for (int i = 0; i < n; i++) {
+        q[i] = (int16_t)nearbyintf(x[i] * iscale);
+    }
+    *s = ggml_bitnet_fx_scale_from_float((double)amax / 32767.0);
+}
+
+int32_t ggml_bitnet_fx_requantize_i32(const int32_t* acc, int n, ggml_bitnet_fx_scale s_acc,
+                                      int8_t* q, ggml_bitnet_fx_scale* s_q) {
+    const uint32_t amax = fx_absmax_i32(acc, n);
+    if (amax == 0 || s_acc.m == 0) {
+        memset(q, 0, n);
+        *s_q = {0, 0};
+        return 0;
+    }
+
+    // q = (acc >> sh) * r >> 23 with acc >> sh within 2^15 and r = 127 * 2^23 / (amax >> sh) below 2^16,
+    // so every product fits in int32
+    const int sh = fx_shift15(amax);
+    const int32_t half = (1 << sh) >> 1;
+    const int32_t a = (int32_t)(amax >> sh);
+    const int32_t r = (int32_t)((((int64_t)127 << 23) + a / 2) / a);
+
+    int i = 0;
+    int32_t sum = 0;
+#if defined(__AVX2__)
+    const __m128i vsh = _mm_cvtsi32_si128(sh);
+    const __m256i vr = _mm256_set1_epi32(r);
+    const __m256i vhalf_in = _mm256_set1_epi32(half);
+    const __m256i vhalf = _mm256_set1_epi32(1 << 22);
+    const __m256i vlo = _mm256_set1_epi32(-127);
+    const __m256i vhi = _mm256_set1_epi32(127);
+    const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    __m256i vsum = _mm256_setzero_si256();
+    for (; i + 32 <= n; i += 32) {
+        __m256i v[4];
+        for (int k = 0; k < 4; k++) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(acc + i + 8 * k));
+            x = _mm256_sra_epi32(_mm256_add_epi32(x, vhalf_in), vsh);
+            x = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(x, vr), vhalf), 23);
+            v[k] = _mm256_min_epi32(_mm256_max_epi32(x, vlo), vhi);
+            vsum = _mm256_add_epi32(vsum, v[k]);
+        }
+        const __m256i p01 = _mm256_packs_epi32(v[0], v[1]);
+        const __m256i p23 = _mm256_packs_epi32(v[2], v[3]);
+        const __m256i p = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(p01, p23), perm);
+        _mm256_storeu_si256((__m256i*)(q + i), p);
+    }
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, vsum);
+    for (int j = 0; j < 8; j++) {
+        sum += lanes[j];
+    }
+#endif
+    for (; i < n; i++) {
+        const int32_t v = (((acc[i] + half) >> sh) * r + (1 << 22)) >> 23;
+        q[i] = (int8_t)std::min(127, std::max(-127, v));
+        sum += q[i];
+    }
+
+    // acc = q * amax / 127
+    static const ggml_bitnet_fx_scale inv127 = ggml_bitnet_fx_scale_from_float(1.0 / 127.0);
+    *s_q = ggml_bitnet_fx_scale_mul(ggml_bitnet_fx_scale_mul(s_acc, fx_make(amax, 31)), inv127);
+    return sum;
+}
+
+void ggml_bitnet_fx_dequantize_i32(const int32_t* acc, int n, ggml_bitnet_fx_scale s_acc, float* y) {
+    const float d = (float)ggml_bitnet_fx_scale_to_float(s_acc);
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256 vd = _mm256_set1_ps(d);
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(acc + i)));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(v, vd));
+    }
+#endif
+    for (; i < n; i++) {
+        y[i] = (float)acc[i] * d;
+    }
+}
+
+/* ========================================================================== */
+/* Elementwise Layers                                                         */
+/* ========================================================================== */
+
+void ggml_bitnet_fx_relu2_mul_i32(const int32_t* gate, ggml_bitnet_fx_scale s_gate,
+                                  const int32_t* up, ggml_bitnet_fx_scale s_up,
+                                  int n, int32_t* out, ggml_bitnet_fx_scale* s_out) {
+    int32_t gmax = 0;
+    for (int i = 0; i < n; i++) {
+        gmax = std::max(gmax, gate[i]);
+    }
+    const uint32_t umax = fx_absmax_i32(up, n);
+    if (gmax == 0 || umax == 0) {
+        memset(out, 0, n * sizeof(int32_t));
+        *s_out = {0, 0};
+        return;
+    }
+
+    const int shg = fx_shift15((uint32_t)gmax);
+    const int shu = fx_shift15(umax);
+    // g^2 * u stays below 2^(2 * bits(g) + bits(u)), bring it back to 30 bits
+    const int k = std::max(0, 2 * fx_bits((uint32_t)gmax >> shg) + fx_bits(umax >> shu) - 30);
+
+    for (int i = 0; i < n; i++) {
+        const int64_t g = std::max(gate[i], 0) >> shg;
+        const int64_t u = up[i] >> shu;
+        out[i] = (int32_t)((g * g * u) >> k);
+    }
+
+    ggml_bitnet_fx_scale s = ggml_bitnet_fx_scale_mul(ggml_bitnet_fx_scale_mul(s_gate, s_gate), s_up);
+    s.e += 2 * shg + shu + k;
+    *s_out = s;
+}
+
+void ggml_bitnet_fx_rmsnorm_i32(int32_t* x, int n, ggml_bitnet_fx_scale* s,
+                                const int16_t* gamma, ggml_bitnet_fx_scale s_gamma, float eps) {
+    const uint32_t amax = fx_absmax_i32(x, n);
+    if (amax == 0 || s->m == 0) {
+        return;
+    }
+    const int sh = fx_shift15(amax);
+
+    int64_t sumsq = 0;
+    for (int i = 0; i < n; i++) {
+        const int64_t v = x[i] >> sh;
+        sumsq += v * v;
+        x[i] = (int32_t)(v * gamma[i]);
+    }
+
+    // one rms per token: the row scale cancels except against eps
+    const double unit = ldexp(ggml_bitnet_fx_scale_to_float(*s), sh);
+    const double rms = sqrt((double)sumsq / n * unit * unit + eps);
+    *s = ggml_bitnet_fx_scale_mul(ggml_bitnet_fx_scale_from_float(unit / rms), s_gamma);
+}
+
+void ggml_bitnet_fx_mul_mat_i2_s(int n, int m, const uint8_t* w, const int8_t* q, int32_t q_sum, int32_t* acc) {
+    for (int r = 0; r < m; r++) {
+        float dot;
+        ggml_vec_dot_i2_i8_s(n, &dot, 0, w + (size_t)r * (n / 4), 0, q, 0, 1);
+        // the kernel sums stored codes 0/1/2 (exact in float for any row length used here),
+        // removing sum(q) maps them to -1/0/+1
+        acc[r] = (int32_t)dot - q_sum;
+    }
+}
+
+/* ========================================================================== */
+/* Error Report                                                               */
+/* ========================================================================== */
+
+void ggml_bitnet_fx_report_reset(ggml_bitnet_fx_report* report) {
+    memset(report, 0, sizeof(*report));
+}
+
+void ggml_bitnet_fx_report_add(ggml_bitnet_fx_report* report, const char* name,
+                               const float* ref, const int32_t* v, ggml_bitnet_fx_scale s, int n) {
+    ggml_bitnet_fx_layer_error* layer = nullptr;
+    for (int i = 0; i < report->n_layers; i++) {
+        if (strncmp(report->layers[i].name, name, sizeof(layer->name)) == 0) {
+            layer = &report->layers[i];
+            break;
+        }
+    }
+    if (!layer) {
+        if (report->n_layers == GGML_BITNET_FX_MAX_LAYERS) {
+            return;
+        }
+        layer = &report->layers[report->n_layers++];
+        snprintf(layer->name, sizeof(layer->name), "%s", name);
+    }
+
+    const double d = ggml_bitnet_fx_scale_to_float(s);
+    for (int i = 0; i < n; i++) {
+        const double err = (double)v[i] * d - (double)ref[i];
+        layer->sum_err2 += err * err;
+        layer->sum_ref2 += (double)ref[i] * ref[i];
+        layer->max_abs = std::max(layer->max_abs, fabs(err));
+    }
+    layer->tokens++;
+}
+
+double ggml_bitnet_fx_layer_rel_error(const ggml_bitnet_fx_layer_error* layer) {
+    return layer->sum_ref2 > 0.0 ? sqrt(layer->sum_err2 / layer->sum_ref2) : 0.0;
+}
+
+void ggml_bitnet_fx_report_print(const ggml_bitnet_fx_report* report, FILE* out) {
+    fprintf(out, "integer pipeline vs float path:\n");
+    for (int i = 0; i < report->n_layers; i++) {
+        const ggml_bitnet_fx_layer_error* layer = &report->layers[i];
+        const double snr = layer->sum_err2 > 0.0 ? 10.0 * log10(layer->sum_ref2 / layer->sum_err2) : INFINITY;
+        fprintf(out, "  %-16s rel rms %.2e, snr %6.1f dB, max abs %.3e (%llu tokens)\n",
+                layer->name, ggml_bitnet_fx_layer_rel_error(layer), snr, layer->max_abs,
+                (unsigned long long)layer->tokens);
+    }
+}
+
+/* ========================================================================== */
+/* BitNet FFN Block                                                           */
+/* ========================================================================== */
+
+static inline size_t fx_pad(size_t size) {
+    return (size + 63) & ~(size_t)63;
+}
+
+size_t ggml_bitnet_fx_ffn_work_size(const ggml_bitnet_fx_ffn* ffn) {
+    return fx_pad(ffn->n_embd) +                       // quantized input
+           2 * fx_pad(ffn->n_ff * sizeof(int32_t)) +   // gate and up accumulators
+           fx_pad(ffn->n_ff) +                         // requantized hidden row
+           fx_pad(ffn->n_embd * sizeof(int32_t));      // down accumulators
+}
+
+// float path as the kernels run it today: dequantize after every matmul, float activation and norm
+static void fx_ffn_reference(const ggml_bitnet_fx_ffn* ffn, const int32_t* gate_acc, const int32_t* up_acc,
+                             ggml_bitnet_fx_scale s_x, std::vector<float>& gate, std::vector<float>& up,
+                             std::vector<float>& act, std::vector<float>& norm, std::vector<float>& down) {
+    const int n_ff = ffn->n_ff;
+    const double x_scale = ggml_bitnet_fx_scale_to_float(s_x);
+    const float gate_scale = (float)(x_scale * ggml_bitnet_fx_scale_to_float(ffn->s_gate));
+    const float up_scale = (float)(x_scale * ggml_bitnet_fx_scale_to_float(ffn->s_up));
+
+    double sumsq = 0.0;
+    for (int i = 0; i < n_ff; i++) {
+        gate[i] = (float)gate_acc[i] * gate_scale;
+        up[i] = (float)up_acc[i] * up_scale;
+        const float g = std::max(gate[i], 0.0f);
+        act[i] = g * g * up[i];
+        sumsq += (double)act[i] * act[i];
+    }
+
+    const float inv_rms = (float)(1.0 / sqrt(sumsq / n_ff + ffn->eps));
+    const float gamma_scale = (float)ggml_bitnet_fx_scale_to_float(ffn->s_sub_norm);
+    for (int i = 0; i < n_ff; i++) {
+        const float gamma = ffn->sub_norm_f32 ? ffn->sub_norm_f32[i] : (float)ffn->sub_norm[i] * gamma_scale;
+        norm[i] = act[i] * inv_rms * gamma;
+    }
+
+    std::vector<int8_t> q(n_ff);
+    std::vector<int32_t> acc(ffn->n_embd);
+    ggml_bitnet_fx_scale s_q;
+    const int32_t q_sum = ggml_bitnet_fx_quantize_f32(norm.data(), n_ff, q.data(), &s_q);
+    ggml_bitnet_fx_mul_mat_i2_s(n_ff, ffn->n_embd, ffn->down, q.data(), q_sum, acc.data());
+    const float down_scale = (float)(ggml_bitnet_fx_scale_to_float(s_q) * ggml_bitnet_fx_scale_to_float(ffn->s_down));
+    for (int i = 0; i < ffn->n_embd; i++) {
+        down[i] = (float)acc[i] * down_scale;
+    }
+}
+
+void ggml_bitnet_fx_ffn_forward(const ggml_bitnet_fx_ffn* ffn, const float* x, float* y,
+                                void* work, ggml_bitnet_fx_report* report) {
+    const int n_embd = ffn->n_embd;
+    const int n_ff = ffn->n_ff;
+
+    uint8_t* p = (uint8_t*)work;
+    int8_t* q_x = (int8_t*)p;      p += fx_pad(n_embd);
+    int32_t* gate = (int32_t*)p;   p += fx_pad(n_ff * sizeof(int32_t));
+    int32_t* up = (int32_t*)p;     p += fx_pad(n_ff * sizeof(int32_t));
+    int8_t* q_h = (int8_t*)p;      p += fx_pad(n_ff);
+    int32_t* down = (int32_t*)p;
+
+    ggml_bitnet_fx_scale s_x;
+    const int32_t x_sum = ggml_bitnet_fx_quantize_f32(x, n_embd, q_x, &s_x);
+
+    ggml_bitnet_fx_mul_mat_i2_s(n_embd, n_ff, ffn->gate, q_x, x_sum, gate);
+    ggml_bitnet_fx_mul_mat_i2_s(n_embd, n_ff, ffn->up, q_x, x_sum, up);
+    const ggml_bitnet_fx_scale s_gate = ggml_bitnet_fx_scale_mul(s_x, ffn->s_gate);
+    const ggml_bitnet_fx_scale s_up = ggml_bitnet_fx_scale_mul(s_x, ffn->s_up);
+
+    std::vector<float> ref_gate, ref_up, ref_act, ref_norm, ref_down;
+    if (report) {
+        ref_gate.resize(n_ff);
+        ref_up.resize(n_ff);
+        ref_act.resize(n_ff);
+        ref_norm.resize(n_ff);
+        ref_down.resize(n_embd);
+        fx_ffn_reference(ffn, gate, up, s_x, ref_gate, ref_up, ref_act, ref_norm, ref_down);
+        ggml_bitnet_fx_report_add(report, "ffn_gate", ref_gate.data(), gate, s_gate, n_ff);
+        ggml_bitnet_fx_report_add(report, "ffn_up", ref_up.data(), up, s_up, n_ff);
+    }
+
+    // the hidden row never leaves the integer domain: activation, sub_norm and requantization in place
+    ggml_bitnet_fx_scale s_h;
+    ggml_bitnet_fx_relu2_mul_i32(gate, s_gate, up, s_up, n_ff, gate, &s_h);
+    if (report) {
+        ggml_bitnet_fx_report_add(report, "ffn_act", ref_act.data(), gate, s_h, n_ff);
+    }
+    ggml_bitnet_fx_rmsnorm_i32(gate, n_ff, &s_h, ffn->sub_norm, ffn->s_sub_norm, ffn->eps);
+    if (report) {
+        ggml_bitnet_fx_report_add(report, "ffn_sub_norm", ref_norm.data(), gate, s_h, n_ff);
+    }
+
+    ggml_bitnet_fx_scale s_qh;
+    const int32_t h_sum = ggml_bitnet_fx_requantize_i32(gate, n_ff, s_h, q_h, &s_qh);
+    ggml_bitnet_fx_mul_mat_i2_s(n_ff, n_embd, ffn->down, q_h, h_sum, down);
+    const ggml_bitnet_fx_scale s_down = ggml_bitnet_fx_scale_mul(s_qh, ffn->s_down);
+    if (report) {
+        ggml_bitnet_fx_report_add(report, "ffn_down", ref_down.data(), down, s_down, n_embd);
+    }
+
+    ggml_bitnet_fx_dequantize_i32(down, n_embd, s_down, y);
+}
@@ -1,8 +1,14 @@
 #include <vector>
 #include <type_traits>
 
+#if defined(BITNET_KERNELS_STANDALONE)
+// built into the standalone kernel library (kernels/): the dot product only, no ggml
+#include "bitnet-kernels-impl.h"
+#else
 #include "ggml-bitnet.h"
 #include "ggml-quants.h"
+#include "ggml-bitnet-bandwidth.h"
+#endif
 #include <cmath>
 #include <cstring>
 
@@ -47,6 +53,7 @@ static inline int hsum_i32_8(const __m256i a) {
 }
 #endif
 
+#if !defined(BITNET_KERNELS_STANDALONE)
 size_t quantize_i2_s(const float * src, void * dst, int64_t nrow, int64_t n_per_row, const float * quant_weights) {
     // 2 bits per weight
 
@@ -94,8 +101,17 @@ size_t quantize_i2_s(const float * src, void * dst, int64_t nrow, int64_t n_per_
     // 32B for alignment
     return nrow * row_size / 4 + 32;
 }
+#endif
 
 void ggml_vec_dot_i2_i8_s(int n, float * s, size_t bs, const void * vx, size_t bx, const void * vy, size_t by, int nrc) {
+#if !defined(BITNET_KERNELS_STANDALONE)
+    // one packed weight row streamed from DRAM; the int8 activations stay in cache across rows
+    // and are not charged (the standalone library charges whole tiles itself)
+    if (ggml_bitnet_bw_active()) {
+        ggml_bitnet_bw_charge_weights((size_t) n / 4);
+    }
+#endif
+
 #ifdef GGML_BITNET_USE_STFMA
     // Use sparse-ternary-fma for large operations
     if (n >= GGML_BITNET_STFMA_THRESHOLD) {
@@ -371,5 +387,274 @@ void ggml_vec_dot_i2_i8_s(int n, float * s, size_t bs, const void * vx, size_t b
     int sumi = vaddlvq_s32(accu_0);
     *s = (float)sumi;
 
+#else
+    int32_t sumi = 0;
+    for (int i = 0; i < n; i++) {
+        const int pos = i % QK_I2_S;
+        sumi += ((x[i / QK_I2_S * 32 + pos % 32] >> (6 - 2 * (pos / 32))) & 3) * y[i];
+    }
+    *s = (float)sumi;
+#endif
+}
+
+#if !defined(BITNET_KERNELS_STANDALONE)
+
+// int8 KV cache
+//
+// K rows and the transposed V rows are stored as blocks of BITNET_QK_KV int8
+// values with one f16 scale. The query is quantized the same way, so QK^T is the
+// int8 block dot below; the softmax weights stay in float and softmax * V scales
+// each V block by its f16 d instead (int8 P costs about 2% relative error).
+
+static_assert(sizeof(bitnet_kv_block_i8) == sizeof(ggml_fp16_t) + BITNET_QK_KV, "wrong int8 KV block size/padding");
+
+static inline float kv_fp16_to_fp32(ggml_fp16_t h) {
+#if defined(__F16C__)
+    return _cvtsh_ss(h);
+#elif defined(__ARM_NEON) && !defined(_MSC_VER)
+    __fp16 tmp;
+    memcpy(&tmp, &h, sizeof(h));
+    return (float)tmp;
+#else
+    return ggml_fp16_to_fp32(h);
+#endif
+}
+
+static inline ggml_fp16_t kv_fp32_to_fp16(float f) {
+#if defined(__F16C__)
+    return _cvtss_sh(f, 0);
+#elif defined(__ARM_NEON) && !defined(_MSC_VER)
+    ggml_fp16_t h;
+    __fp16 tmp = f;
+    memcpy(&h, &tmp, sizeof(h));
+    return h;
+#else
+    return ggml_fp32_to_fp16(f);
+#endif
+}
+
+void ggml_bitnet_kv_quantize_row_i8(const float * x, bitnet_kv_block_i8 * y, int n) {
+    const int nb = n / BITNET_QK_KV;
+    for (int i = 0; i < nb; i++) {
+        float amax = 0.0f;
+        for (int j = 0; j < BITNET_QK_KV; j++) {
+            amax = fmaxf(amax, fabsf(x[i * BITNET_QK_KV + j]));
+        }
+        const float d = amax / 127.0f;
+        const float id = d ? 1.0f / d : 0.0f;
+        y[i].d = kv_fp32_to_fp16(d);
+        for (int j = 0; j < BITNET_QK_KV; j++) {
+            y[i].qs[j] = (int8_t)roundf(x[i * BITNET_QK_KV + j] * id);
+        }
+    }
+}
+
+void ggml_bitnet_kv_dequantize_row_i8(const bitnet_kv_block_i8 * x, float * y, int n) {
+    const int nb = n / BITNET_QK_KV;
+    for (int i = 0; i < nb; i++) {
+        for (int j = 0; j < BITNET_QK_KV; j++) {
+            y[i * BITNET_QK_KV + j] = kv_fp16_to_fp32(x[i].d) * x[i].qs[j];
+        }
+    }
+}
+
+float ggml_bitnet_kv_vec_dot_i8(int n, const bitnet_kv_block_i8 * x, const bitnet_kv_block_i8 * y) {
+    const int nb = n / BITNET_QK_KV;
+
+#if defined(__AVX2__)
+
+    float sumf = 0.0f;
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    for (int i = 0; i < nb; i++) {
+        const __m256i xq8 = _mm256_loadu_si256((const __m256i *)x[i].qs);
+        const __m256i yq8 = _mm256_loadu_si256((const __m256i *)y[i].qs);
+
+        // maddubs needs an unsigned operand: move the sign of x onto y
+        const __m256i ax = _mm256_sign_epi8(xq8, xq8);
+        const __m256i sy = _mm256_sign_epi8(yq8, xq8);
+
+        // each int16 holds 2 products of at most 127 * 127, no saturation
+        const __m256i dot16 = _mm256_maddubs_epi16(ax, sy);
+        const __m256i dot32 = _mm256_madd_epi16(dot16, ones);
+
+        sumf += kv_fp16_to_fp32(x[i].d) * kv_fp16_to_fp32(y[i].d) * hsum_i32_8(dot32);
+    }
+    return sumf;
+
+#elif defined(__ARM_NEON)
+
+    float32x4_t acc = vdupq_n_f32(0.0f);
+
+    for (int i = 0; i < nb; i++) {
+        const int8x16_t xq8_0 = vld1q_s8(x[i].qs);
+        const int8x16_t xq8_1 = vld1q_s8(x[i].qs + 16);
+        const int8x16_t yq8_0 = vld1q_s8(y[i].qs);
+        const int8x16_t yq8_1 = vld1q_s8(y[i].qs + 16);
+
+#if defined(__ARM_FEATURE_DOTPROD)
+        int32x4_t dot = vdotq_s32(vdupq_n_s32(0), xq8_0, yq8_0);
+        dot = vdotq_s32(dot, xq8_1, yq8_1);
+#else
+        int16x8_t dot16_0 = vmull_s8(vget_low_s8(xq8_0), vget_low_s8(yq8_0));
+        int16x8_t dot16_1 = vmull_s8(vget_high_s8(xq8_0), vget_high_s8(yq8_0));
+        dot16_0 = vmlal_s8(dot16_0, vget_low_s8(xq8_1), vget_low_s8(yq8_1));
+        dot16_1 = vmlal_s8(dot16_1, vget_high_s8(xq8_1), vget_high_s8(yq8_1));
+        const int32x4_t dot = vaddq_s32(vpaddlq_s16(dot16_0), vpaddlq_s16(dot16_1));
+#endif
+        acc = vmlaq_n_f32(acc, vcvtq_f32_s32(dot), kv_fp16_to_fp32(x[i].d) * kv_fp16_to_fp32(y[i].d));
+    }
+    return vaddvq_f32(acc);
+
+#else
+
+    float sumf = 0.0f;
+    for (int i = 0; i < nb; i++) {
+        int sumi = 0;
+        for (int j = 0; j < BITNET_QK_KV; j++) {
+            sumi += x[i].qs[j] * y[i].qs[j];
+        }
+        sumf += kv_fp16_to_fp32(x[i].d) * kv_fp16_to_fp32(y[i].d) * sumi;
+    }
+    return sumf;
+
+#endif
+}
+
+void ggml_bitnet_kv_store_v_i8(int head_dim, int n_ctx, bitnet_kv_block_i8 * vt, int pos, const float * v) {
+    const int nb_ctx = n_ctx / BITNET_QK_KV;
+    const int ib = pos / BITNET_QK_KV;
+    const int j = pos % BITNET_QK_KV;
+
+    for (int c = 0; c < head_dim; c++) {
+        bitnet_kv_block_i8 * b = &vt[c * nb_ctx + ib];
+        if (j == 0) {
+            // first token of the block: stale values from an earlier sequence must not keep the scale up
+            memset(b->qs, 0, sizeof(b->qs));
+            b->d = kv_fp32_to_fp16(0.0f);
+        }
+        float d = kv_fp16_to_fp32(b->d);
+        const float ax = fabsf(v[c]);
+        if (ax > 127.0f * d) {
+            // value does not fit, widen the scale and requantize the tokens already in the block
+            const ggml_fp16_t dh = kv_fp32_to_fp16(ax / 127.0f);
+            const float r = d / kv_fp16_to_fp32(dh);
+            for (int t = 0; t < j; t++) {
+                b->qs[t] = (int8_t)roundf(b->qs[t] * r);
+            }
+            b->d = dh;
+            d = kv_fp16_to_fp32(dh);
+        }
+        // an f16 d can round below ax / 127 (by far for subnormal scales), clamp instead of wrapping
+        b->qs[j] = d ? (int8_t)fminf(fmaxf(roundf(v[c] / d), -127.0f), 127.0f) : 0;
+    }
+}
+
+// out[c] = sum_t p[t] * v[c][t] over nb blocks of every transposed V row, P in float
+static void kv_softmax_v(int head_dim, int nb, int nb_ctx, const float * p, const bitnet_kv_block_i8 * vt, float * out) {
+#if defined(__AVX2__)
+
+    // 8 channels at a time share the loads of p and land in out with one transposing reduction
+    for (int c = 0; c < head_dim; c += 8) {
+        __m256 acc[8];
+        for (int r = 0; r < 8; r++) {
+            acc[r] = _mm256_setzero_ps();
+        }
+        for (int i = 0; i < nb; i++) {
+            const __m256 p0 = _mm256_loadu_ps(p + i * BITNET_QK_KV + 0);
+            const __m256 p1 = _mm256_loadu_ps(p + i * BITNET_QK_KV + 8);
+            const __m256 p2 = _mm256_loadu_ps(p + i * BITNET_QK_KV + 16);
+            const __m256 p3 = _mm256_loadu_ps(p + i * BITNET_QK_KV + 24);
+            for (int r = 0; r < 8; r++) {
+                const bitnet_kv_block_i8 * b = &vt[(c + r) * nb_ctx + i];
+                const __m128i v0 = _mm_loadu_si128((const __m128i *)b->qs);
+                const __m128i v1 = _mm_loadu_si128((const __m128i *)(b->qs + 16));
+                __m256 dot = _mm256_mul_ps(p0, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v0)));
+                dot = _mm256_add_ps(_mm256_mul_ps(p1, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(v0, 8)))), dot);
+                dot = _mm256_add_ps(_mm256_mul_ps(p2, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v1))), dot);
+                dot = _mm256_add_ps(_mm256_mul_ps(p3, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(v1, 8)))), dot);
+                acc[r] = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kv_fp16_to_fp32(b->d)), dot), acc[r]);
+            }
+        }
+        // lane r of the result is the sum of acc[r]
+        const __m256 s01 = _mm256_hadd_ps(acc[0], acc[1]);
+        const __m256 s23 = _mm256_hadd_ps(acc[2], acc[3]);
+        const __m256 s45 = _mm256_hadd_ps(acc[4], acc[5]);
+        const __m256 s67 = _mm256_hadd_ps(acc[6], acc[7]);
+        const __m256 s0123 = _mm256_hadd_ps(s01, s23);
+        const __m256 s4567 = _mm256_hadd_ps(s45, s67);
+        _mm256_storeu_ps(out + c, _mm256_add_ps(_mm256_permute2f128_ps(s0123, s4567, 0x20),
+                                                _mm256_permute2f128_ps(s0123, s4567, 0x31)));
+    }
+
+#elif defined(__ARM_NEON)
+
+    for (int c = 0; c < head_dim; c++) {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (int i = 0; i < nb; i++) {
+            const bitnet_kv_block_i8 * b = &vt[c * nb_ctx + i];
+            float32x4_t dot = vdupq_n_f32(0.0f);
+            for (int j = 0; j < BITNET_QK_KV; j += 8) {
+                const int16x8_t v16 = vmovl_s8(vld1_s8(b->qs + j));
+                dot = vmlaq_f32(dot, vld1q_f32(p + i * BITNET_QK_KV + j), vcvtq_f32_s32(vmovl_s16(vget_low_s16(v16))));
+                dot = vmlaq_f32(dot, vld1q_f32(p + i * BITNET_QK_KV + j + 4), vcvtq_f32_s32(vmovl_s16(vget_high_s16(v16))));
+            }
+            acc = vmlaq_n_f32(acc, dot, kv_fp16_to_fp32(b->d));
+        }
+        out[c] = vaddvq_f32(acc);
+    }
+
+#else
+
+    for (int c = 0; c < head_dim; c++) {
+        float sumf = 0.0f;
+        for (int i = 0; i < nb; i++) {
+            const bitnet_kv_block_i8 * b = &vt[c * nb_ctx + i];
+            float sumb = 0.0f;
+            for (int j = 0; j < BITNET_QK_KV; j++) {
+                sumb += p[i * BITNET_QK_KV + j] * b->qs[j];
+            }
+            sumf += kv_fp16_to_fp32(b->d) * sumb;
+        }
+        out[c] = sumf;
+    }
+
+#endif
+}
+
+void ggml_bitnet_kv_attn_i8(int n_kv, int n_past, int head_dim, int n_ctx, const float * q, const bitnet_kv_block_i8 * k,
+                            const bitnet_kv_block_i8 * vt, float scale, float * scores, float * out) {
+    GGML_ASSERT(head_dim % BITNET_QK_KV == 0 && head_dim <= 16 * BITNET_QK_KV);
+    GGML_ASSERT(n_kv % BITNET_QK_KV == 0 && n_past <= n_kv && n_kv <= n_ctx);
+
+    const int nb_head = head_dim / BITNET_QK_KV;
+    const int nb_ctx = n_ctx / BITNET_QK_KV;
+
+    bitnet_kv_block_i8 qb[16];
+    ggml_bitnet_kv_quantize_row_i8(q, qb, head_dim);
+
+    // QK^T
+    float max = -INFINITY;
+    for (int t = 0; t < n_past; t++) {
+        scores[t] = scale * ggml_bitnet_kv_vec_dot_i8(head_dim, k + t * nb_head, qb);
+        max = fmaxf(max, scores[t]);
+    }
+
+    // softmax, masked tail keys get weight 0
+    float sum = 0.0f;
+    for (int t = 0; t < n_past; t++) {
+        scores[t] = expf(scores[t] - max);
+        sum += scores[t];
+    }
+    const float isum = sum > 0.0f ? 1.0f / sum : 0.0f;
+    for (int t = 0; t < n_past; t++) {
+        scores[t] *= isum;
+    }
+    for (int t = n_past; t < n_kv; t++) {
+        scores[t] = 0.0f;
+    }
+
+    // softmax * V: float weights against each transposed V row, blocks past n_past hold only masked keys
+    kv_softmax_v(head_dim, (n_past + BITNET_QK_KV - 1) / BITNET_QK_KV, nb_ctx, scores, vt, out);
+}
 #endif
-}
\ No newline at end of file
@@ -0,0 +1,30 @@
+/**
+ * BitNet Low-Jitter Decode Helpers - Implementation
+ *
+ * Licensed under the Apache License, Version 2.0
+ */
+
+#include "ggml-bitnet-realtime.h"
+
+#include <chrono>
+
+void ggml_bitnet_rt_partition(int ith, int nth, int n, int align, int* start, int* end) {
+    if (align < 1) {
+        align = 1;
+    }
+    const int n_units = (n + align - 1) / align;
+    const int per_thread = n_units / nth;
+    const int extra = n_units % nth;
+
+    // the first `extra` threads take one more unit
+    const int unit_start = ith * per_thread + (ith < extra ? ith : extra);
+    const int unit_end = unit_start + per_thread + (ith < extra ? 1 : 0);
+
+    *start = unit_start * align < n ? unit_start * align : n;
+    *end = unit_end * align < n ? unit_end * align : n;
+}
+
+uint64_t ggml_bitnet_rt_now_ns(void) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,681 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ggml-bitnet.h"
+#include "ggml-bitnet-pack.h"
+#include "ggml-bitnet-selftest.h"
+
+#ifdef GGML_BITNET_USE_STFMA
+#include "ggml-bitnet-stfma.h"
+#include "ggml-bitnet-stfma-cache.h"
+#include "ggml-bitnet-stfma-avx2.h"
+#include "ggml-bitnet-stfma-avx512.h"
+#endif
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+extern "C" void ggml_vec_dot_i2_i8_s(int n, float * s, size_t bs, const void * vx, size_t bx, const void * vy, size_t by, int nrc);
+
+// keep the baseline scalar, otherwise the compiler vectorizes it and the speedups shrink
+#if defined(__clang__)
+#define SELFTEST_NO_VECTORIZE _Pragma("clang loop vectorize(disable) interleave(disable)")
+#define SELFTEST_SCALAR
+#elif defined(__GNUC__)
+#define SELFTEST_NO_VECTORIZE
+#define SELFTEST_SCALAR __attribute__((optimize("no-tree-vectorize")))
+#else
+#define SELFTEST_NO_VECTORIZE
+#define SELFTEST_SCALAR
+#endif
+
+// minimum speedup of a kernel over the scalar baseline, below it the host counts as unhealthy
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__ARM_NEON)
+#define SELFTEST_MIN_SPEEDUP_MAD   4.0
+#define SELFTEST_MIN_SPEEDUP_STFMA 2.0
+#define SELFTEST_MIN_SPEEDUP_TL    4.0
+#else
+#define SELFTEST_MIN_SPEEDUP_MAD   0.5
+#define SELFTEST_MIN_SPEEDUP_STFMA 0.5
+#define SELFTEST_MIN_SPEEDUP_TL    0.5
+#endif
+
+namespace {
+
+struct selftest_check {
+    std::string name;
+    ggml_bitnet_health status;
+    std::string detail;
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+// ggml_bitnet_ref_vec_dot_i2_i8_s kept out of the vectorizer, the baseline the kernels are timed against
+SELFTEST_SCALAR int32_t scalar_vec_dot_i2_i8_s(int n, const uint8_t * x, const int8_t * y) {
+    int32_t sum = 0;
+    SELFTEST_NO_VECTORIZE
+    for (int i = 0; i < n; i++) {
+        const int blk = i / GGML_BITNET_QK_I2_S;
+        const int j = i % GGML_BITNET_QK_I2_S;
+        const int q = (x[blk * 32 + j % 32] >> (6 - 2 * (j / 32))) & 0x3;
+        sum += q * y[i];
+    }
+    return sum;
+}
+
+// rows per second of fn, best of 3 batches of at least 10 ms each
+template <typename F>
+double measure_rate(int rows_per_call, F fn) {
+    using clock = std::chrono::steady_clock;
+    fn();
+    double best = 0.0;
+    for (int rep = 0; rep < 3; rep++) {
+        int calls = 0;
+        const auto start = clock::now();
+        double elapsed = 0.0;
+        do {
+            fn();
+            calls++;
+            elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        } while (elapsed < 0.01);
+        const double rate = (double)calls * rows_per_call / elapsed;
+        best = rate > best ? rate : best;
+    }
+    return best;
+}
+
+#if defined(__AVX512F__)
+// seconds for a dependent multiply-add chain, proportional to the core clock
+double time_scalar_chain() {
+    using clock = std::chrono::steady_clock;
+    volatile uint64_t seed = 1;
+    uint64_t x = seed;
+    const auto start = clock::now();
+    for (int i = 0; i < 200000; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    seed = x;
+    return elapsed;
+}
+#endif
+
+std::string read_first_line(const char * path) {
+    FILE * f = fopen(path, "r");
+    if (!f) {
+        return "";
+    }
+    char buf[512] = {0};
+    if (!fgets(buf, sizeof(buf), f)) {
+        buf[0] = 0;
+    }
+    fclose(f);
+    std::string s(buf);
+    while (!s.empty() && (s.back() == '\n' || s.back() == ' ')) {
+        s.pop_back();
+    }
+    return s;
+}
+
+std::string cpu_model() {
+    FILE * f = fopen("/proc/cpuinfo", "r");
+    if (!f) {
+        return "unknown";
+    }
+    char line[512];
+    std::string model = "unknown";
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "model name", 10) == 0 || strncmp(line, "CPU part", 8) == 0) {
+            const char * colon = strchr(line, ':');
+            if (colon) {
+                model = colon + 2;
+                model.erase(model.find_last_not_of("\n ") + 1);
+            }
+            break;
+        }
+    }
+    fclose(f);
+    return model;
+}
+
+/* ========================================================================== */
+/* Host checks                                                                */
+/* ========================================================================== */
+
+selftest_check check_isa(std::string & build_isa, std::string & host_isa) {
+    selftest_check c = {"isa", GGML_BITNET_HEALTH_PASS, "", {}};
+
+#if defined(__AVX512F__)
+    build_isa = "avx512";
+#elif defined(__AVX2__)
+    build_isa = "avx2";
+#elif defined(__ARM_FEATURE_DOTPROD)
+    build_isa = "neon+dotprod";
+#elif defined(__ARM_NEON)
+    build_isa = "neon";
+#else
+    build_isa = "scalar";
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    const bool has_avx2 = __builtin_cpu_supports("avx2");
+    const bool has_avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    host_isa = has_avx512 ? "avx512" : has_avx2 ? "avx2" : "scalar";
+    if (has_avx2 && build_isa == "scalar") {
+        c.status = GGML_BITNET_HEALTH_FAIL;
+        c.detail = "binary built without AVX2 on an AVX2 host, kernels run their scalar paths";
+    } else if (has_avx512 && build_isa == "avx2") {
+        // a deliberate choice on hosts that downclock under AVX-512, not a fault
+        c.detail = "build avx2 on an AVX-512 host";
+    }
+#elif defined(__aarch64__) && defined(__linux__)
+    const bool has_dotprod = (getauxval(AT_HWCAP) & HWCAP_ASIMDDP) != 0;
+    host_isa = has_dotprod ? "neon+dotprod" : "neon";
+    if (has_dotprod && build_isa != "neon+dotprod") {
+        c.status = GGML_BITNET_HEALTH_WARN;
+        c.detail = "host supports dotprod but the binary was built without it";
+    }
+#else
+    host_isa = build_isa;
+#endif
+    if (c.detail.empty()) {
+        c.detail = "build " + build_isa + ", host " + host_isa;
+    }
+    return c;
+}
+
+selftest_check check_hugepages() {
+    selftest_check c = {"hugepages", GGML_BITNET_HEALTH_PASS, "", {}};
+#if defined(__linux__)
+    const std::string thp = read_first_line("/sys/kernel/mm/transparent_hugepage/enabled");
+    if (thp.empty()) {
+        c.detail = "transparent hugepages not available";
+    } else if (thp.find("[never]") != std::string::npos) {
+        c.status = GGML_BITNET_HEALTH_WARN;
+        c.detail = "transparent hugepages disabled, weight and KV buffers pay 4K TLB misses";
+    } else {
+        c.detail = "transparent hugepages: " + thp;
+    }
+#else
+    c.detail = "not checked on this platform";
+#endif
+    return c;
+}
+
+selftest_check check_numa() {
+    selftest_check c = {"numa", GGML_BITNET_HEALTH_PASS, "", {}};
+#if defined(__linux__)
+    std::vector<std::vector<int>> node_cpus;
+    DIR * dir = opendir("/sys/devices/system/node");
+    if (dir) {
+        struct dirent * e;
+        while ((e = readdir(dir)) != nullptr) {
+            int node;
+            if (sscanf(e->d_name, "node%d", &node) != 1) {
+                continue;
+            }
+            std::vector<int> cpus;
+            const std::string list = read_first_line(("/sys/devices/system/node/" + std::string(e->d_name) + "/cpulist").c_str());
+            size_t pos = 0;
+            while (pos < list.size()) {
+                int lo, hi;
+                const size_t next = list.find(',', pos);
+                const std::string part = list.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+                if (sscanf(part.c_str(), "%d-%d", &lo, &hi) == 2) {
+                    for (int i = lo; i <= hi; i++) cpus.push_back(i);
+                } else if (sscanf(part.c_str(), "%d", &lo) == 1) {
+                    cpus.push_back(lo);
+                }
+                pos = next == std::string::npos ? list.size() : next + 1;
+            }
+            node_cpus.push_back(cpus);
+        }
+        closedir(dir);
+    }
+    c.metrics.push_back({"nodes", (double)node_cpus.size()});
+    if (node_cpus.size() <= 1) {
+        c.detail = "single NUMA node";
+        return c;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    int spanned = 0;
+    for (const auto & cpus : node_cpus) {
+        for (int cpu : cpus) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &set)) {
+                spanned++;
+                break;
+            }
+        }
+    }
+    c.metrics.push_back({"nodes_spanned", (double)spanned});
+
+    int mode = 0;
+    unsigned long mask[16] = {0};
+    syscall(SYS_get_mempolicy, &mode, mask, sizeof(mask) * 8, nullptr, 0);
+    const bool numa_balancing = read_first_line("/proc/sys/kernel/numa_balancing") == "1";
+
+    // MPOL_DEFAULT allocates on the first-touch node, threads on other nodes then read remote memory
+    if (spanned > 1 && mode == 0) {
+        c.status = GGML_BITNET_HEALTH_WARN;
+        c.detail = "threads span " + std::to_string(spanned) + " NUMA nodes with the default memory policy, "
+                   "pin with numactl --cpunodebind/--membind or interleave";
+    } else if (numa_balancing) {
+        c.status = GGML_BITNET_HEALTH_WARN;
+        c.detail = "kernel.numa_balancing is on, page migration adds latency spikes";
+    } else {
+        c.detail = "threads confined to " + std::to_string(spanned) + " of " + std::to_string(node_cpus.size()) + " NUMA nodes";
+    }
+#else
+    c.detail = "not checked on this platform";
+#endif
+    return c;
+}
+
+/* ========================================================================== */
+/* Kernel probes                                                              */
+/* ========================================================================== */
+
+struct probe_data {
+    int n;
+    int rows;
+    std::vector<uint8_t> weights;   // rows * n / 4, I2_S
+    std::vector<int8_t> act;        // n
+    int32_t act_sum;                // sum of act, removes the +1 offset of the I2_S codes
+    std::vector<int32_t> expected;  // rows, sum(w * act) with w in {-1, 0, +1}
+};
+
+probe_data make_probe_data(int n, int rows, uint32_t seed) {
+    probe_data d;
+    d.n = n;
+    d.rows = rows;
+    d.weights.resize((size_t)rows * n / 4);
+    d.act.resize(n);
+    d.expected.resize(rows);
+
+    std::mt19937 rng(seed);
+    std::vector<int8_t> t((size_t)rows * n);
+    for (auto & v : t) v = (int8_t)((int)(rng() % 3) - 1);
+    d.act_sum = 0;
+    for (auto & v : d.act) {
+        v = (int8_t)((int)(rng() % 255) - 127);
+        d.act_sum += v;
+    }
+    // exact ternary reference on the unpacked trits, independent of the I2_S layout
+    for (int r = 0; r < rows; r++) {
+        ggml_bitnet_pack_i2_s(t.data() + (size_t)r * n, d.weights.data() + (size_t)r * n / 4, n);
+        d.expected[r] = ggml_bitnet_ref_dot_ternary(t.data() + (size_t)r * n, d.act.data(), n);
+    }
+    return d;
+}
+
+double scalar_rate(const probe_data & d) {
+    volatile int32_t sink = 0;
+    return measure_rate(d.rows, [&]() {
+        for (int r = 0; r < d.rows; r++) {
+            sink = sink + scalar_vec_dot_i2_i8_s(d.n, d.weights.data() + (size_t)r * d.n / 4, d.act.data());
+        }
+    });
+}
+
+selftest_check probe_mad() {
+    // ggml_vec_dot_i2_i8_s as the matmuls call it, at the row lengths of the BitNet models
+    // (where built, this includes the STFMA path above GGML_BITNET_STFMA_THRESHOLD)
+    selftest_check c = {"mad", GGML_BITNET_HEALTH_PASS, "", {}};
+#if !defined(__AVX2__) && !defined(__ARM_NEON)
+    c.status = GGML_BITNET_HEALTH_FAIL;
+    c.detail = "ggml_vec_dot_i2_i8_s has no kernel for the build ISA";
+    return c;
+#endif
+    const probe_data probes[] = {make_probe_data(2560, 64, 1), make_probe_data(4096, 64, 4)};
+
+    for (const probe_data & d : probes) {
+        int mismatches = 0;
+        for (int r = 0; r < d.rows; r++) {
+            float s = 0.0f;
+            ggml_vec_dot_i2_i8_s(d.n, &s, 0, d.weights.data() + (size_t)r * d.n / 4, 0, d.act.data(), 0, 1);
+            mismatches += (int32_t)s - d.act_sum != d.expected[r];
+        }
+        if (mismatches) {
+            c.status = GGML_BITNET_HEALTH_FAIL;
+            c.detail = std::to_string(mismatches) + " of " + std::to_string(d.rows) + " rows of " + std::to_string(d.n) +
+                       " differ from the ternary reference";
+            return c;
+        }
+    }
+
+    const probe_data & d = probes[0];
+#ifdef GGML_BITNET_USE_STFMA
+    // rows at or above the threshold take the STFMA path, hold them to what that path should reach
+    const bool stfma_path = d.n >= GGML_BITNET_STFMA_THRESHOLD;
+#else
+    const bool stfma_path = false;
+#endif
+    const double min_speedup = stfma_path ? SELFTEST_MIN_SPEEDUP_STFMA : SELFTEST_MIN_SPEEDUP_MAD;
+
+    volatile float sink = 0.0f;
+    const double rate = measure_rate(d.rows, [&]() {
+        for (int r = 0; r < d.rows; r++) {
+            float s;
+            ggml_vec_dot_i2_i8_s(d.n, &s, 0, d.weights.data() + (size_t)r * d.n / 4, 0, d.act.data(), 0, 1);
+            sink = sink + s;
+        }
+    });
+    const double speedup = rate / scalar_rate(d);
+    c.metrics.push_back({"gweights_per_s", rate * d.n / 1e9});
+    c.metrics.push_back({"speedup_vs_scalar", speedup});
+    c.metrics.push_back({"expected_min_speedup", min_speedup});
+    c.metrics.push_back({"stfma_path", stfma_path ? 1.0 : 0.0});
+    if (speedup < min_speedup) {
+        c.status = GGML_BITNET_HEALTH_FAIL;
+        c.detail = stfma_path ? "ggml_vec_dot_i2_i8_s below the expected speed for this ISA on the STFMA path, "
+                                "rows of " + std::to_string(d.n) + " are at or above GGML_BITNET_STFMA_THRESHOLD"
+                              : "ggml_vec_dot_i2_i8_s below the expected speed for this ISA";
+    } else {
+        c.detail = "ok";
+    }
+    return c;
+}
+
+#ifdef GGML_BITNET_USE_STFMA
+selftest_check probe_stfma(std::vector<selftest_check> & extra) {
+    const probe_data d = make_probe_data(4096, 16, 2);
+    selftest_check c = {"stfma", GGML_BITNET_HEALTH_PASS, "", {}};
+
+    std::vector<ggml_bitnet_stfma_cache_handle> handles(d.rows);
+    for (int r = 0; r < d.rows; r++) {
+        handles[r] = ggml_bitnet_stfma_cache_weights(d.weights.data() + (size_t)r * d.n / 4, d.n);
+    }
+
+    int mismatches = 0;
+    for (int r = 0; r < d.rows; r++) {
+        float s = 0.0f;
+        ggml_vec_dot_i2_i8_s_stfma_cached(d.n, &s, handles[r], d.act.data());
+        mismatches += (int32_t)s - d.act_sum != d.expected[r];
+    }
+
+    if (mismatches) {
+        c.status = GGML_BITNET_HEALTH_FAIL;
+        c.detail = std::to_string(mismatches) + " of " + std::to_string(d.rows) + " rows differ from the ternary reference";
+    } else {
+        volatile float sink = 0.0f;
+        const double rate = measure_rate(d.rows, [&]() {
+            for (int r = 0; r < d.rows; r++) {
+                float s;
+                ggml_vec_dot_i2_i8_s_stfma_cached(d.n, &s, handles[r], d.act.data());
+                sink = sink + s;
+            }
+        });
+        const double speedup = rate / scalar_rate(d);
+        c.metrics.push_back({"gweights_per_s", rate * d.n / 1e9});
+        c.metrics.push_back({"speedup_vs_scalar", speedup});
+        c.metrics.push_back({"expected_min_speedup", SELFTEST_MIN_SPEEDUP_STFMA});
+        if (speedup < SELFTEST_MIN_SPEEDUP_STFMA) {
+            c.status = GGML_BITNET_HEALTH_FAIL;
+            c.detail = "cached STFMA path below the expected speed for this ISA";
+        } else {
+            c.detail = "ok";
+        }
+    }
+
+#if defined(__AVX512F__)
+    // a latency-bound scalar chain runs at core frequency: if it slows down right after
+    // AVX-512 bursts, the core drops to a lower license level whenever the kernels run
+    {
+        std::vector<int32_t> act32(d.act.begin(), d.act.end());
+        const uint8_t * w = ggml_bitnet_stfma_get_cached_weights(handles[0]);
+        volatile int32_t sink = 0;
+        std::vector<double> cold, hot;
+        for (int rep = 0; rep < 21; rep++) {
+            cold.push_back(time_scalar_chain());
+            for (int i = 0; i < 64; i++) {
+                sink = sink + ggml_bitnet_stfma_dense_avx512_tail(w, act32.data(), d.n);
+            }
+            hot.push_back(time_scalar_chain());
+        }
+        std::sort(cold.begin(), cold.end());
+        std::sort(hot.begin(), hot.end());
+        const double slowdown = hot[hot.size() / 2] / cold[cold.size() / 2];
+
+        selftest_check f = {"avx512_frequency", GGML_BITNET_HEALTH_PASS, "", {}};
+        f.metrics.push_back({"scalar_slowdown_after_avx512", slowdown});
+        if (slowdown > 1.1) {
+            f.status = GGML_BITNET_HEALTH_WARN;
+            f.detail = "core clocks down after AVX-512 bursts, consider an AVX2 build for this host";
+        } else {
+            f.detail = "ok";
+        }
+        extra.push_back(f);
+    }
+#else
+    (void)extra;
+#endif
+
+    for (auto h : handles) {
+        ggml_bitnet_stfma_free_cached_weights(h);
+    }
+    return c;
+}
+#endif
+
+#if defined(GGML_BITNET_X86_TL2) || defined(GGML_BITNET_ARM_TL1)
+#if defined(GGML_BITNET_LUT_PROBE_M)
+// scalar ternary row times float activations, the baseline the LUT kernel is measured against
+SELFTEST_SCALAR float ref_ternary_dot(int k, const int8_t * w, const bitnet_float_type * x) {
+    float sum = 0.0f;
+    SELFTEST_NO_VECTORIZE
+    for (int i = 0; i < k; i++) {
+        sum += w[i] * x[i];
+    }
+    return sum;
+}
+#endif
+
+selftest_check probe_tl() {
+    selftest_check c = {"tl", GGML_BITNET_HEALTH_PASS, "", {}};
+#if !defined(GGML_BITNET_LUT_PROBE_M)
+    c.status = GGML_BITNET_HEALTH_WARN;
+    c.detail = "no kernel_config.ini at configure time, TL kernels not probed";
+    return c;
+#else
+    // the smallest shape of the generated kernels (kernel_config.ini)
+    const int m = GGML_BITNET_LUT_PROBE_M, k = GGML_BITNET_LUT_PROBE_K, BM = GGML_BITNET_LUT_PROBE_BM;
+    std::mt19937 rng(3);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<int8_t> t((size_t)m * k);
+    for (auto & v : t) v = (int8_t)((int)(rng() % 3) - 1);
+    std::vector<bitnet_float_type> x(k);
+    for (auto & v : x) v = dist(rng);
+    // packed like bitnet_kernels_lut_prepack and the GGUF converter
+#if defined(GGML_BITNET_X86_TL2)
+    std::vector<uint8_t> a(ggml_bitnet_tl2_size(m, k, GGML_BITNET_LUT_PROBE_BK));
+    ggml_bitnet_pack_tl2(t.data(), m, k, BM, GGML_BITNET_LUT_PROBE_BK, a.data());
+#else
+    std::vector<uint8_t> a((size_t)m * k / 4);
+    ggml_bitnet_pack_tl1(t.data(), m, k, BM, GGML_BITNET_LUT_PROBE_BK, GGML_BITNET_LUT_PROBE_BMM, a.data());
+#endif
+    bitnet_float_type scale = 0.37f;
+    std::vector<float> y(m);
+
+#if defined(GGML_BITNET_X86_TL2)
+    const int three_k = ggml_bitnet_tl2_three_k(k, GGML_BITNET_LUT_PROBE_BK), two_k = k - three_k;
+    const size_t three_size = (size_t)three_k / 3 * 32, two_size = (size_t)two_k / 2 * 32;
+    std::vector<int8_t> three_ref(three_size), two_ref(two_size), three(three_size), two(two_size);
+    bitnet_float_type lut_scale_ref = 0, lut_scale = 0;
+
+    // the threaded preprocessor must build the serial one's LUTs
+    ggml_preprocessor(1, m, three_k, two_k, x.data(), &lut_scale_ref, three_ref.data(), two_ref.data());
+    for (int ith = 0; ith < 4; ith++) {
+        ggml_preprocessor_scales_mt(ith, 4, 1, three_k, two_k, x.data(), &lut_scale);
+    }
+    for (int ith = 0; ith < 4; ith++) {
+        ggml_preprocessor_mt(ith, 4, 1, three_k, two_k, x.data(), &lut_scale, three.data(), two.data());
+    }
+    const bool same = three == three_ref && two == two_ref && lut_scale == lut_scale_ref;
+
+    const size_t three_bytes = (size_t)m * three_k / 6, sign_bytes = (size_t)m * three_k / 24;
+    auto gemv = [&]() {
+        ggml_preprocessor(1, m, three_k, two_k, x.data(), &lut_scale, three.data(), two.data());
+        for (int T = 0; T < m / BM; T++) {
+            // the triple pass leaves int32 partial sums in y, the pair pass adds its own and scales
+            uint8_t * a3 = (uint8_t *)a.data() + (size_t)T * BM * three_k / 6;
+            uint8_t * sign = (uint8_t *)a.data() + three_bytes + (size_t)T * BM * three_k / 24;
+            uint8_t * a2 = (uint8_t *)a.data() + three_bytes + sign_bytes + (size_t)T * BM * two_k / 4;
+            ggml_qgemm_lut(1, m, k, three_k, a3, sign, three.data(), &scale, &lut_scale, y.data() + (size_t)T * BM);
+            ggml_qgemm_lut(1, m, k, two_k, a2, nullptr, two.data(), &scale, &lut_scale, y.data() + (size_t)T * BM);
+        }
+    };
+#else
+    std::vector<int8_t> qlut_ref((size_t)k / 16 * 256), qlut(qlut_ref.size());
+    bitnet_float_type lut_scale_ref = 0, lut_scale = 0;
+
+    // the threaded preprocessor must build the serial one's LUT
+    ggml_preprocessor(m, k, x.data(), &lut_scale_ref, qlut_ref.data());
+    for (int ith = 0; ith < 4; ith++) {
+        ggml_preprocessor_scales_mt(ith, 4, 1, k, x.data(), &lut_scale);
+    }
+    for (int ith = 0; ith < 4; ith++) {
+        ggml_preprocessor_mt(ith, 4, k, x.data(), &lut_scale, qlut.data());
+    }
+    const bool same = qlut == qlut_ref && lut_scale == lut_scale_ref;
+
+    auto gemv = [&]() {
+        ggml_preprocessor(m, k, x.data(), &lut_scale, qlut.data());
+        for (int T = 0; T < m / BM; T++) {
+            ggml_qgemm_lut(m, k, (uint8_t *)a.data() + (size_t)T * BM * k / 4, qlut.data(), &scale, &lut_scale,
+                           y.data() + (size_t)T * BM);
+        }
+    };
+#endif
+
+    if (!same) {
+        c.status = GGML_BITNET_HEALTH_FAIL;
+        c.detail = "threaded LUT preprocessing differs from ggml_preprocessor";
+        return c;
+    }
+
+    // activations are quantized per LUT entry, so compare the whole output against the float product
+    gemv();
+    double err = 0.0, norm = 0.0;
+    for (int r = 0; r < m; r++) {
+        double ref = 0.0;
+        for (int i = 0; i < k; i++) ref += t[(size_t)r * k + i] * (double)x[i];
+        ref *= scale;
+        err += (y[r] - ref) * (y[r] - ref);
+        norm += ref * ref;
+    }
+    const double rel = norm > 0.0 ? std::sqrt(err / norm) : 0.0;
+    c.metrics.push_back({"relative_error", rel});
+    if (!(rel < 3e-2)) {
+        c.status = GGML_BITNET_HEALTH_FAIL;
+        c.detail = "ggml_qgemm_lut differs from the float reference on " + std::to_string(m) + "x" + std::to_string(k);
+        return c;
+    }
+
+    const double rate = measure_rate(m, gemv);
+    volatile float sink = 0.0f;
+    const double scalar = measure_rate(m, [&]() {
+        for (int r = 0; r < m; r++) {
+            sink = sink + ref_ternary_dot(k, t.data() + (size_t)r * k, x.data());
+        }
+    });
+    const double speedup = rate / scalar;
+    c.metrics.push_back({"gweights_per_s", rate * k / 1e9});
+    c.metrics.push_back({"speedup_vs_scalar", speedup});
+    c.metrics.push_back({"expected_min_speedup", SELFTEST_MIN_SPEEDUP_TL});
+    if (speedup < SELFTEST_MIN_SPEEDUP_TL) {
+        c.status = GGML_BITNET_HEALTH_FAIL;
+        c.detail = "TL kernel below the expected speed for this ISA";
+    } else {
+        c.detail = "ok";
+    }
+    return c;
+#endif
+}
+#endif
+
+void write_json_string(FILE * out, const std::string & s) {
+    fputc('"', out);
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            fputc('\\', out);
+        }
+        fputc(ch, out);
+    }
+    fputc('"', out);
+}
+
+const char * health_name(ggml_bitnet_health h) {
+    switch (h) {
+        case GGML_BITNET_HEALTH_PASS: return "healthy";
+        case GGML_BITNET_HEALTH_WARN: return "degraded";
+        default:                      return "unhealthy";
+    }
+}
+
+const char * check_status_name(ggml_bitnet_health h) {
+    switch (h) {
+        case GGML_BITNET_HEALTH_PASS: return "pass";
+        case GGML_BITNET_HEALTH_WARN: return "warn";
+        default:                      return "fail";
+    }
+}
+
+} // namespace
+
+enum ggml_bitnet_health ggml_bitnet_selftest(FILE * out) {
+    std::string build_isa, host_isa;
+    std::vector<selftest_check> checks;
+
+    checks.push_back(check_isa(build_isa, host_isa));
+    checks.push_back(check_hugepages());
+    checks.push_back(check_numa());
+    checks.push_back(probe_mad());
+#ifdef GGML_BITNET_USE_STFMA
+    std::vector<selftest_check> extra;
+    checks.push_back(probe_stfma(extra));
+    checks.insert(checks.end(), extra.begin(), extra.end());
+#endif
+#if defined(GGML_BITNET_X86_TL2) || defined(GGML_BITNET_ARM_TL1)
+    checks.push_back(probe_tl());
+#endif
+
+    ggml_bitnet_health overall = GGML_BITNET_HEALTH_PASS;
+    for (const auto & c : checks) {
+        overall = c.status > overall ? c.status : overall;
+    }
+
+    if (out) {
+        fprintf(out, "{\n  \"status\": \"%s\",\n  \"cpu\": {\"model\": ", health_name(overall));
+        write_json_string(out, cpu_model());
+        fprintf(out, ", \"build_isa\": \"%s\", \"host_isa\": \"%s\"},\n  \"checks\": [\n", build_isa.c_str(), host_isa.c_str());
+        for (size_t i = 0; i < checks.size(); i++) {
+            const auto & c = checks[i];
+            fprintf(out, "    {\"name\": \"%s\", \"status\": \"%s\", \"detail\": ", c.name.c_str(), check_status_name(c.status));
+            write_json_string(out, c.detail);
+            for (const auto & m : c.metrics) {
+                fprintf(out, ", \"%s\": %.3f", m.first.c_str(), m.second);
+            }
+            fprintf(out, "}%s\n", i + 1 < checks.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+    return overall;
+}
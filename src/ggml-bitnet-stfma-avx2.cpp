@@ -0,0 +1,100 @@
+#include "ggml-bitnet-stfma.h"
+#include "ggml-bitnet-stfma-avx2.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+/**
+ * Vectorized AVX2 dense ternary FMA kernel
+ * 
+ * Key points:
+ * 1. One 32-bit load feeds 16 trits, split across two 8-lane vectors
+ * 2. Branchless trit unpacking using variable shifts
+ * 3. Decode identical to stfma_decode_trit(): (t & 1) - (t >> 1)
+ * 4. _mm256_sign_epi32 applies the ternary weight without a multiply
+ */
+
+/**
+ * Unpack 8 2-bit trits of a broadcast packed word into 8 int32 lanes
+ */
+static inline __m256i unpack_trits_avx2(__m256i packed_vec, __m256i shift_amounts) {
+    __m256i shifted = _mm256_srlv_epi32(packed_vec, shift_amounts);
+    return _mm256_and_si256(shifted, _mm256_set1_epi32(0x3));
+}
+
+/**
+ * Decode STFMA trits to signed values: 0b00→0, 0b01→+1, 0b10→-1
+ * Vector form of stfma_decode_trit()
+ */
+static inline __m256i decode_trits_avx2(__m256i encoded) {
+    __m256i low = _mm256_and_si256(encoded, _mm256_set1_epi32(1));
+    __m256i high = _mm256_srli_epi32(encoded, 1);
+    return _mm256_sub_epi32(low, high);
+}
+
+/**
+ * Horizontal sum of 8 int32 values in a __m256i vector
+ */
+static inline int32_t horizontal_sum_avx2(__m256i vec) {
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(vec), _mm256_extracti128_si256(vec, 1));
+    __m128i hi64 = _mm_unpackhi_epi64(sum128, sum128);
+    __m128i sum64 = _mm_add_epi32(hi64, sum128);
+    __m128i hi32 = _mm_shuffle_epi32(sum64, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_cvtsi128_si32(_mm_add_epi32(sum64, hi32));
+}
+
+int32_t ggml_bitnet_stfma_dense_avx2(
+    const uint8_t* weights,
+    const int32_t* activations,
+    size_t n
+) {
+    const __m256i shift_lo = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i shift_hi = _mm256_setr_epi32(16, 18, 20, 22, 24, 26, 28, 30);
+
+    __m256i acc_lo = _mm256_setzero_si256();
+    __m256i acc_hi = _mm256_setzero_si256();
+
+    // Process 16 elements per iteration
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint32_t packed;
+        memcpy(&packed, &weights[i / 4], sizeof(packed));
+        __m256i packed_vec = _mm256_set1_epi32((int32_t)packed);
+
+        __m256i w_lo = decode_trits_avx2(unpack_trits_avx2(packed_vec, shift_lo));
+        __m256i w_hi = decode_trits_avx2(unpack_trits_avx2(packed_vec, shift_hi));
+
+        __m256i a_lo = _mm256_loadu_si256((const __m256i*)&activations[i]);
+        __m256i a_hi = _mm256_loadu_si256((const __m256i*)&activations[i + 8]);
+
+        // sign(a, w) == a * w for w in {-1, 0, +1}
+        acc_lo = _mm256_add_epi32(acc_lo, _mm256_sign_epi32(a_lo, w_lo));
+        acc_hi = _mm256_add_epi32(acc_hi, _mm256_sign_epi32(a_hi, w_hi));
+    }
+
+    int32_t result = horizontal_sum_avx2(_mm256_add_epi32(acc_lo, acc_hi));
+
+    // Tail: fewer than 16 elements left
+    for (; i < n; i++) {
+        uint8_t trit = (weights[i / 4] >> ((i % 4) * 2)) & 0x3;
+        result += stfma_decode_trit(trit) * activations[i];
+    }
+
+    return result;
+}
+
+#else
+// Fallback for non-AVX2 systems
+int32_t ggml_bitnet_stfma_dense_avx2(
+    const uint8_t* weights,
+    const int32_t* activations,
+    size_t n
+) {
+    (void)weights;
+    (void)activations;
+    (void)n;
+    return 0; // Should never be called
+}
+#endif
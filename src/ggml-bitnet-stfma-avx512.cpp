@@ -1,6 +1,8 @@
 #include "ggml-bitnet-stfma.h"
+#include "ggml-bitnet-stfma-avx512.h"
 #include <immintrin.h>
 #include <stdint.h>
+#include <string.h>
 
 /**
  * Fully vectorized AVX-512 dense ternary FMA kernel
@@ -43,16 +45,15 @@ static inline __m512i unpack_trits_avx512(uint32_t packed) {
 }
 
 /**
- * Convert 2-bit encoded trits to signed values: 0→-1, 1→0, 2→+1
- * Input: __m512i with values in range [0, 2]
+ * Decode STFMA trits to signed values: 0b00→0, 0b01→+1, 0b10→-1
+ * Vector form of stfma_decode_trit(): (t & 1) - (t >> 1)
+ * Input: __m512i with 2-bit values
  * Output: __m512i with values in range [-1, +1]
  */
 static inline __m512i decode_trits_avx512(__m512i encoded) {
-    // Create constant vectors
-    __m512i ones = _mm512_set1_epi32(1);
-    
-    // Subtract 1 to map: 0→-1, 1→0, 2→+1
-    return _mm512_sub_epi32(encoded, ones);
+    __m512i low = _mm512_and_si512(encoded, _mm512_set1_epi32(1));
+    __m512i high = _mm512_srli_epi32(encoded, 1);
+    return _mm512_sub_epi32(low, high);
 }
 
 /**
@@ -104,7 +105,7 @@ int32_t ggml_bitnet_stfma_dense_avx512(
         // Unpack 16 trits to int32 (branchless, fully vectorized)
         __m512i trit_vec = unpack_trits_avx512(packed);
         
-        // Decode to signed values: 0→-1, 1→0, 2→+1
+        // Decode to signed values: 0b00→0, 0b01→+1, 0b10→-1
         __m512i weight_vec = decode_trits_avx512(trit_vec);
         
         // Load 16 activations
@@ -148,8 +149,9 @@ int32_t ggml_bitnet_stfma_dense_avx512_tail(
         size_t remaining = n - i;
         __mmask16 mask = (__mmask16)((1 << remaining) - 1);
         
-        // Load with mask
-        uint32_t packed = *(const uint32_t*)&weights[i / 4];
+        // Load only the bytes that hold the remaining trits
+        uint32_t packed = 0;
+        memcpy(&packed, &weights[i / 4], (remaining + 3) / 4);
         __m512i trit_vec = unpack_trits_avx512(packed);
         __m512i weight_vec = decode_trits_avx512(trit_vec);
         __m512i act_vec = _mm512_maskz_loadu_epi32(mask, &activations[i]);
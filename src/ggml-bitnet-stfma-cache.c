@@ -35,11 +35,36 @@ void ggml_bitnet_stfma_cache_init(void) {
     g_cache.total_bytes = 0;
 }
 
+void ggml_bitnet_stfma_repack_i2_s(
+    const uint8_t* bitnet_weights,
+    uint8_t* stfma_weights,
+    size_t n
+) {
+    const size_t block = GGML_BITNET_STFMA_CACHE_BLOCK;
+    
+    // Output byte 8 * g + i holds elements 32 * g + 4 * i .. + 3, which sit in
+    // the 2-bit field g of the 4 input bytes at 4 * i: gather the fields into
+    // the byte lanes of a word, then multiply them down into one byte
+    for (size_t b = 0; b < n / block; b++) {
+        const uint8_t* src = bitnet_weights + b * block / 4;
+        uint8_t* dst = stfma_weights + b * block / 4;
+        for (int g = 0; g < 4; g++) {
+            for (int i = 0; i < 8; i++) {
+                uint32_t w;
+                memcpy(&w, src + 4 * i, sizeof(w));
+                const uint32_t fields = (w >> (6 - 2 * g)) & 0x03030303u;
+                const uint8_t linear = (uint8_t)((fields * 0x01041040u) >> 24);
+                dst[8 * g + i] = convert_bitnet_to_stfma_byte(linear);
+            }
+        }
+    }
+}
+
 ggml_bitnet_stfma_cache_handle ggml_bitnet_stfma_cache_weights(
     const uint8_t* bitnet_weights,
     size_t n
 ) {
-    if (!bitnet_weights || n == 0) {
+    if (!bitnet_weights || n == 0 || n % GGML_BITNET_STFMA_CACHE_BLOCK != 0) {
         return NULL;
     }
     
@@ -51,7 +76,7 @@ ggml_bitnet_stfma_cache_handle ggml_bitnet_stfma_cache_weights(
     }
     
     // Calculate size: n elements = n/4 bytes (2 bits per element)
-    size_t size_bytes = (n + 3) / 4;
+    size_t size_bytes = n / 4;
     
     // Allocate memory for converted weights
     entry->stfma_weights = malloc(size_bytes);
@@ -62,11 +87,9 @@ ggml_bitnet_stfma_cache_handle ggml_bitnet_stfma_cache_weights(
     
     entry->size_bytes = size_bytes;
     
-    // Convert all weights using branchless conversion
+    // Convert and repack all weights using branchless conversion
     // This happens ONCE at load time
-    for (size_t i = 0; i < size_bytes; i++) {
-        entry->stfma_weights[i] = convert_bitnet_to_stfma_byte(bitnet_weights[i]);
-    }
+    ggml_bitnet_stfma_repack_i2_s(bitnet_weights, entry->stfma_weights, n);
     
     // Add to cache linked list
     entry->next = g_cache.head;
@@ -11,14 +11,38 @@
 
 #include "ggml-bitnet-stfma.h"
 #include "ggml-bitnet-stfma-cache.h"
-#include "ggml-bitnet-stfma-avx512.h"
+#include "ggml-bitnet-bandwidth.h"
 #include <string.h>
 
+/**
+ * Widen int8 activations to int32 and return their sum
+ * 
+ * The sum converts the ternary result back to the sum((w + 1) * y)
+ * convention of ggml_vec_dot_i2_i8_s.
+ */
+static int32_t stfma_load_activations(
+    const int8_t* activations_i8,
+    int32_t* activations_i32,
+    int n
+) {
+#if defined(__AVX2__)
+    convert_int8_to_int32_avx2(activations_i8, activations_i32, n);
+#else
+    convert_int8_to_int32_scalar(activations_i8, activations_i32, n);
+#endif
+    
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += activations_i32[i];
+    }
+    return sum;
+}
+
 /**
  * Cached inference function for ggml_vec_dot_i2_i8_s
  * 
  * This function assumes weights have been pre-converted and cached.
- * It performs zero conversions during inference.
+ * It performs zero weight conversions during inference.
  * 
  * @param n Number of elements
  * @param s Output: dot product result
@@ -38,56 +62,47 @@ void ggml_vec_dot_i2_i8_s_stfma_cached(
         return;
     }
     
-    const int8_t* activations_i8 = (const int8_t*)vy;
-    
     // Ensure we have buffer space for int32 activations
     stfma_ensure_buffer_size(n);
+    struct stfma_thread_buffers* buffers = stfma_get_thread_buffers();
     
-    // Convert activations from int8 to int32 (vectorized)
-#if defined(__AVX2__)
-    convert_i8_to_i32_avx2(activations_i8, tl_buffers.int32_buffer, n);
-#else
-    // Scalar fallback
-    for (int i = 0; i < n; i++) {
-        tl_buffers.int32_buffer[i] = (int32_t)activations_i8[i];
-    }
-#endif
+    int32_t act_sum = stfma_load_activations((const int8_t*)vy, buffers->int32_buffer, n);
+    int32_t result = ggml_bitnet_stfma_dense(stfma_weights, buffers->int32_buffer, n);
     
-    // Compute dot product using fully vectorized AVX-512 kernel
-#if defined(__AVX512F__)
-    int32_t result = ggml_bitnet_stfma_dense_avx512_tail(
-        stfma_weights,
-        tl_buffers.int32_buffer,
-        n
-    );
-#elif defined(__AVX2__)
-    // AVX2 fallback (to be implemented)
-    int32_t result = 0;
-    for (int i = 0; i < n; i++) {
-        // Decode trit from packed format
-        int byte_idx = i / 4;
-        int trit_idx = i % 4;
-        uint8_t byte = stfma_weights[byte_idx];
-        uint8_t trit = (byte >> (trit_idx * 2)) & 0x3;
-        
-        // Convert to signed: 0→-1, 1→0, 2→+1
-        int32_t weight = (int32_t)trit - 1;
-        result += weight * tl_buffers.int32_buffer[i];
-    }
-#else
-    // Scalar fallback
-    int32_t result = 0;
-    for (int i = 0; i < n; i++) {
-        int byte_idx = i / 4;
-        int trit_idx = i % 4;
-        uint8_t byte = stfma_weights[byte_idx];
-        uint8_t trit = (byte >> (trit_idx * 2)) & 0x3;
-        int32_t weight = (int32_t)trit - 1;
-        result += weight * tl_buffers.int32_buffer[i];
+    // Cached weights are the only DRAM stream of a row; the activations stay in cache
+    if (ggml_bitnet_bw_active()) {
+        ggml_bitnet_bw_charge_weights((size_t)n / 4);
     }
-#endif
     
-    *s = (float)result;
+    *s = (float)(result + act_sum);
+}
+
+/**
+ * ggml_vec_dot_i2_i8_s for rows of GGML_BITNET_STFMA_THRESHOLD elements or more
+ * 
+ * Repacks the I2_S row into the thread's encoding buffer, then runs the same
+ * dense kernel and act_sum correction as the cached path, so the result is
+ * the sum((w + 1) * y) that ggml_vec_dot_i2_i8_s returns.
+ */
+void ggml_vec_dot_i2_i8_stfma(
+    int n,
+    float* s,
+    size_t bs,
+    const void* vx,
+    size_t bx,
+    const void* vy,
+    size_t by,
+    int nrc
+) {
+    stfma_ensure_buffer_size(n);
+    struct stfma_thread_buffers* buffers = stfma_get_thread_buffers();
+    
+    ggml_bitnet_stfma_repack_i2_s((const uint8_t*)vx, buffers->encoding_buffer, n);
+    
+    int32_t act_sum = stfma_load_activations((const int8_t*)vy, buffers->int32_buffer, n);
+    int32_t result = ggml_bitnet_stfma_dense(buffers->encoding_buffer, buffers->int32_buffer, n);
+    
+    *s = (float)(result + act_sum);
 }
 
 /**
@@ -98,7 +113,7 @@ void ggml_vec_dot_i2_i8_s_stfma_cached(
  * 
  * @param n Number of elements
  * @param s Output: dot product result
- * @param vx BitNet weights (either raw or cached handle)
+ * @param vx I2_S weights or cached handle
  * @param vy int8 activations
  * @param use_cache Whether to use cached weights
  */
@@ -117,49 +132,7 @@ void ggml_vec_dot_i2_i8_s_stfma_hybrid(
     } else {
         // Fall back to JIT conversion (original implementation)
         // This path should rarely be used in production
-        const uint8_t* bitnet_weights = (const uint8_t*)vx;
-        const int8_t* activations_i8 = (const int8_t*)vy;
-        
-        // Ensure buffers
-        stfma_ensure_buffer_size(n);
-        
-        // Convert weights (JIT - expensive!)
-        size_t num_bytes = (n + 3) / 4;
-        convert_bitnet_to_stfma_array(
-            bitnet_weights,
-            tl_buffers.encoding_buffer,
-            num_bytes
-        );
-        
-        // Convert activations
-#if defined(__AVX2__)
-        convert_i8_to_i32_avx2(activations_i8, tl_buffers.int32_buffer, n);
-#else
-        for (int i = 0; i < n; i++) {
-            tl_buffers.int32_buffer[i] = (int32_t)activations_i8[i];
-        }
-#endif
-        
-        // Compute
-#if defined(__AVX512F__)
-        int32_t result = ggml_bitnet_stfma_dense_avx512_tail(
-            tl_buffers.encoding_buffer,
-            tl_buffers.int32_buffer,
-            n
-        );
-#else
-        int32_t result = 0;
-        for (int i = 0; i < n; i++) {
-            int byte_idx = i / 4;
-            int trit_idx = i % 4;
-            uint8_t byte = tl_buffers.encoding_buffer[byte_idx];
-            uint8_t trit = (byte >> (trit_idx * 2)) & 0x3;
-            int32_t weight = (int32_t)trit - 1;
-            result += weight * tl_buffers.int32_buffer[i];
-        }
-#endif
-        
-        *s = (float)result;
+        ggml_vec_dot_i2_i8_stfma(n, s, 0, vx, 0, vy, 0, 1);
     }
 }
 
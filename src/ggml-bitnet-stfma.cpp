@@ -6,6 +6,8 @@
  */
 
 #include "ggml-bitnet-stfma.h"
+#include "ggml-bitnet-stfma-avx2.h"
+#include "ggml-bitnet-stfma-avx512.h"
 
 #if defined(__AVX2__) || defined(__AVX512F__)
 #include <immintrin.h>
@@ -37,6 +39,10 @@ void stfma_ensure_buffer_size(size_t required_size) {
     }
 }
 
+struct stfma_thread_buffers* stfma_get_thread_buffers(void) {
+    return &tl_buffers;
+}
+
 void stfma_free_buffers(void) {
     free(tl_buffers.encoding_buffer);
     free(tl_buffers.int32_buffer);
@@ -216,17 +222,8 @@ void sparse_ternary_fma_int32_scalar(
 ) {
     for (size_t i = 0; i < N; i++) {
         // Extract 2-bit trit from packed array
-        size_t byte_idx = i / 4;
-        size_t trit_offset = (i % 4) * 2;
-        uint8_t trit = (B_trit[byte_idx] >> trit_offset) & 0b11;
-        
-        // Decode and accumulate (STFMA encoding)
-        if (trit == 0b01) {       // +1
-            C[i] += A[i];
-        } else if (trit == 0b10) { // -1
-            C[i] -= A[i];
-        }
-        // else: trit == 0b00 (0), skip (no contribution)
+        uint8_t trit = (B_trit[i / 4] >> ((i % 4) * 2)) & 0b11;
+        C[i] += stfma_decode_trit(trit) * A[i];
     }
 }
 
@@ -238,73 +235,33 @@ void sparse_ternary_fma_int32_avx2(
     int32_t* C,
     size_t N
 ) {
-    const __m256i zero = _mm256_setzero_si256();
+    const __m256i shift_amounts = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
     const __m256i one = _mm256_set1_epi32(1);
+    const __m256i mask_2bits = _mm256_set1_epi32(0b11);
     
     size_t i = 0;
     
     // Process 8 elements at a time
     for (; i + 8 <= N; i += 8) {
-        // Load 8 coefficients
-        __m256i a_vec = _mm256_loadu_si256((__m256i*)&A[i]);
-        
-        // Load 8 accumulators
-        __m256i c_vec = _mm256_loadu_si256((__m256i*)&C[i]);
-        
-        // Load 2 bytes containing 8 trits (8 × 2 bits = 16 bits)
-        size_t byte_idx = i / 4;
-        uint16_t trit_packed = ((uint16_t)B_trit[byte_idx + 1] << 8) | B_trit[byte_idx];
-        
-        // Unpack 8 2-bit trits directly into 8 int32 lanes using SIMD
-        // Broadcast the 16-bit value to all lanes as 32-bit
-        __m256i packed_vec = _mm256_set1_epi32(trit_packed);
-        
-        // Create shift amounts for each lane: 0, 2, 4, 6, 8, 10, 12, 14
-        __m256i shift_amounts = _mm256_setr_epi32(
-            0, 2, 4, 6, 8, 10, 12, 14
-        );
-        
-        // Shift each lane by its corresponding amount
-        __m256i shifted = _mm256_srlv_epi32(packed_vec, shift_amounts);
-        
-        // Mask to extract only the lowest 2 bits from each lane
-        __m256i mask_2bits = _mm256_set1_epi32(0b11);
-        __m256i trit_vec = _mm256_and_si256(shifted, mask_2bits);
-        
-        // Create nonzero mask: true if trit != 0b00
-        __m256i nonzero_cmp = _mm256_cmpgt_epi32(trit_vec, zero);
-        
-        // Extract sign bit (high bit of 2-bit trit)
-        // For STFMA encoding: 0b01 (+1) has sign=0, 0b10 (-1) has sign=1
-        __m256i sign_bit = _mm256_srli_epi32(trit_vec, 1);
-        __m256i sign_bit_masked = _mm256_and_si256(sign_bit, one);
-        __m256i sign_cmp = _mm256_cmpgt_epi32(sign_bit_masked, zero);
+        __m256i a_vec = _mm256_loadu_si256((const __m256i*)&A[i]);
+        __m256i c_vec = _mm256_loadu_si256((const __m256i*)&C[i]);
         
-        // Compute contribution: 0 if trit=0, A if trit!=0
-        __m256i contribution = _mm256_and_si256(a_vec, nonzero_cmp);
+        // Unpack 8 2-bit trits (2 bytes) into 8 int32 lanes
+        uint16_t trit_packed = ((uint16_t)B_trit[i / 4 + 1] << 8) | B_trit[i / 4];
+        __m256i trit_vec = _mm256_and_si256(
+            _mm256_srlv_epi32(_mm256_set1_epi32(trit_packed), shift_amounts), mask_2bits);
         
-        // Conditionally negate if sign=1 (i.e., trit=0b10=-1)
-        __m256i negated = _mm256_sub_epi32(zero, contribution);
-        contribution = _mm256_blendv_epi8(contribution, negated, sign_cmp);
+        // Vector form of stfma_decode_trit(), applied with a sign operation
+        __m256i weight = _mm256_sub_epi32(_mm256_and_si256(trit_vec, one), _mm256_srli_epi32(trit_vec, 1));
+        c_vec = _mm256_add_epi32(c_vec, _mm256_sign_epi32(a_vec, weight));
         
-        // FMA: C += contribution
-        c_vec = _mm256_add_epi32(c_vec, contribution);
-        
-        // Store result
         _mm256_storeu_si256((__m256i*)&C[i], c_vec);
     }
     
     // Process remaining elements
     for (; i < N; i++) {
-        size_t byte_idx = i / 4;
-        size_t trit_offset = (i % 4) * 2;
-        uint8_t trit = (B_trit[byte_idx] >> trit_offset) & 0b11;
-        
-        if (trit == 0b01) {
-            C[i] += A[i];
-        } else if (trit == 0b10) {
-            C[i] -= A[i];
-        }
+        uint8_t trit = (B_trit[i / 4] >> ((i % 4) * 2)) & 0b11;
+        C[i] += stfma_decode_trit(trit) * A[i];
     }
 }
 
@@ -318,77 +275,37 @@ void sparse_ternary_fma_int32_avx512(
     int32_t* C,
     size_t N
 ) {
-    const __m512i zero = _mm512_setzero_si512();
+    const __m512i shift_amounts = _mm512_setr_epi32(
+        0, 2, 4, 6, 8, 10, 12, 14,
+        16, 18, 20, 22, 24, 26, 28, 30
+    );
     const __m512i one = _mm512_set1_epi32(1);
+    const __m512i mask_2bits = _mm512_set1_epi32(0b11);
     
     size_t i = 0;
     
     // Process 16 elements at a time
     for (; i + 16 <= N; i += 16) {
-        // Load 16 coefficients
         __m512i a_vec = _mm512_loadu_si512(&A[i]);
-        
-        // Load 16 accumulators
         __m512i c_vec = _mm512_loadu_si512(&C[i]);
         
-        // Load 4 bytes containing 16 trits (16 × 2 bits = 32 bits)
-        size_t byte_idx = i / 4;
-        uint32_t trit_packed = *(uint32_t*)&B_trit[byte_idx];
-        
-        // Unpack 16 2-bit trits directly into 16 int32 lanes using SIMD
-        // Strategy: Broadcast the 32-bit value, then use shifts and masks
-        // to extract each 2-bit pair into its own 32-bit lane
-        
-        // Broadcast the packed trits to all lanes
-        __m512i packed_vec = _mm512_set1_epi32(trit_packed);
-        
-        // Create shift amounts for each lane: 0, 2, 4, 6, ..., 30
-        // Lane i needs to shift right by (i * 2) bits
-        __m512i shift_amounts = _mm512_setr_epi32(
-            0, 2, 4, 6, 8, 10, 12, 14,
-            16, 18, 20, 22, 24, 26, 28, 30
-        );
-        
-        // Shift each lane by its corresponding amount
-        __m512i shifted = _mm512_srlv_epi32(packed_vec, shift_amounts);
-        
-        // Mask to extract only the lowest 2 bits from each lane
-        __m512i mask_2bits = _mm512_set1_epi32(0b11);
-        __m512i trit_vec = _mm512_and_si512(shifted, mask_2bits);
-        
-        // Create nonzero mask
-        __mmask16 nonzero_mask = _mm512_cmpneq_epi32_mask(trit_vec, zero);
-        
-        // Extract sign bit
-        __m512i sign_bit = _mm512_srli_epi32(trit_vec, 1);
-        __m512i sign_bit_masked = _mm512_and_si512(sign_bit, one);
-        __mmask16 sign_mask = _mm512_cmpneq_epi32_mask(sign_bit_masked, zero);
+        // Unpack 16 2-bit trits (4 bytes) into 16 int32 lanes
+        uint32_t trit_packed;
+        memcpy(&trit_packed, &B_trit[i / 4], sizeof(trit_packed));
+        __m512i trit_vec = _mm512_and_si512(
+            _mm512_srlv_epi32(_mm512_set1_epi32(trit_packed), shift_amounts), mask_2bits);
         
-        // Compute contribution: 0 if trit=0, A if trit!=0
-        __m512i contribution = _mm512_maskz_mov_epi32(nonzero_mask, a_vec);
+        // Vector form of stfma_decode_trit()
+        __m512i weight = _mm512_sub_epi32(_mm512_and_si512(trit_vec, one), _mm512_srli_epi32(trit_vec, 1));
+        c_vec = _mm512_add_epi32(c_vec, _mm512_mullo_epi32(a_vec, weight));
         
-        // Conditionally negate if sign=1
-        __m512i negated = _mm512_sub_epi32(zero, contribution);
-        contribution = _mm512_mask_blend_epi32(sign_mask, contribution, negated);
-        
-        // FMA: C += contribution
-        c_vec = _mm512_add_epi32(c_vec, contribution);
-        
-        // Store result
         _mm512_storeu_si512(&C[i], c_vec);
     }
     
     // Process remaining elements
     for (; i < N; i++) {
-        size_t byte_idx = i / 4;
-        size_t trit_offset = (i % 4) * 2;
-        uint8_t trit = (B_trit[byte_idx] >> trit_offset) & 0b11;
-        
-        if (trit == 0b01) {
-            C[i] += A[i];
-        } else if (trit == 0b10) {
-            C[i] -= A[i];
-        }
+        uint8_t trit = (B_trit[i / 4] >> ((i % 4) * 2)) & 0b11;
+        C[i] += stfma_decode_trit(trit) * A[i];
     }
 }
 
@@ -417,59 +334,21 @@ void sparse_ternary_fma_int32(
     sparse_ternary_fma_int32_scalar(A, B_trit, C, N);
 }
 
-/* ========================================================================== */
-/* BitNet Integration Functions                                              */
-/* ========================================================================== */
-
-void ggml_vec_dot_i2_i8_stfma(
-    int n,
-    float* s,
-    size_t bs,
-    const void* vx,
-    size_t bx,
-    const void* vy,
-    size_t by,
-    int nrc
+int32_t ggml_bitnet_stfma_dense(
+    const uint8_t* weights,
+    const int32_t* activations,
+    size_t n
 ) {
-    const uint8_t* x = (uint8_t*)vx;
-    const int8_t* y = (int8_t*)vy;
-    
-    // Ensure buffers are large enough
-    stfma_ensure_buffer_size(n);
-    
-    // Get thread-local buffers
-    uint8_t* x_stfma = tl_buffers.encoding_buffer;
-    int32_t* y_int32 = tl_buffers.int32_buffer;
-    int32_t* accumulator = tl_buffers.accumulator_buffer;
-    
-    // Clear accumulator
-    memset(accumulator, 0, n * sizeof(int32_t));
-    
-    // Convert BitNet encoding to STFMA encoding
-    size_t num_bytes = n / 4;
 #if defined(__AVX512F__)
-    convert_bitnet_to_stfma_avx512(x, x_stfma, num_bytes);
+    return ggml_bitnet_stfma_dense_avx512_tail(weights, activations, n);
 #elif defined(__AVX2__)
-    convert_bitnet_to_stfma_avx2(x, x_stfma, num_bytes);
-#else
-    convert_bitnet_to_stfma_array(x, x_stfma, num_bytes);
-#endif
-    
-    // Convert int8 to int32
-#if defined(__AVX2__)
-    convert_int8_to_int32_avx2(y, y_int32, n);
+    return ggml_bitnet_stfma_dense_avx2(weights, activations, n);
 #else
-    convert_int8_to_int32_scalar(y, y_int32, n);
-#endif
-    
-    // Perform sparse ternary FMA
-    sparse_ternary_fma_int32(y_int32, x_stfma, accumulator, n);
-    
-    // Sum accumulator
-    int64_t sum = 0;
-    for (int i = 0; i < n; i++) {
-        sum += accumulator[i];
+    int32_t result = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t trit = (weights[i / 4] >> ((i % 4) * 2)) & 0x3;
+        result += stfma_decode_trit(trit) * activations[i];
     }
-    
-    *s = (float)sum;
+    return result;
+#endif
 }
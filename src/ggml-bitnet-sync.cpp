@@ -0,0 +1,337 @@
+/**
+ * BitNet Low-Latency Fork/Join - Implementation
+ *
+ * Licensed under the Apache License, Version 2.0
+ */
+
+#include "ggml-bitnet-sync.h"
+#include "ggml-bitnet-realtime.h"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#pragma comment(lib, "synchronization.lib")
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#define SYNC_CACHE_LINE 64
+
+/* ========================================================================== */
+/* Futex and CPU Relax                                                        */
+/* ========================================================================== */
+
+static inline void sync_relax(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// sleep while *addr == expected; may return spuriously
+static void sync_futex_wait(std::atomic<uint32_t>* addr, uint32_t expected) {
+#if defined(__linux__)
+    syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#elif defined(_WIN32)
+    WaitOnAddress((volatile VOID*)addr, &expected, sizeof(expected), INFINITE);
+#else
+    // no futex: a short sleep, the caller re-checks
+    (void)expected;
+    (void)addr;
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+}
+
+static void sync_futex_wake(std::atomic<uint32_t>* addr) {
+#if defined(__linux__)
+    syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+#elif defined(_WIN32)
+    WakeByAddressAll((PVOID)addr);
+#else
+    (void)addr;
+#endif
+}
+
+/* ========================================================================== */
+/* Team Layout                                                                */
+/* ========================================================================== */
+
+// one cache line per thread: the go flag it waits on, its spin state and counters
+struct alignas(SYNC_CACHE_LINE) team_slot {
+    std::atomic<uint32_t> go;
+    std::atomic<uint32_t> parked;
+    uint64_t spin_ns;
+    uint64_t spin_max_ns;   // 0: never spin (more threads than cores)
+    // written only by the slot's thread, read by ggml_bitnet_team_get_stats from any thread
+    std::atomic<uint64_t> waits;
+    std::atomic<uint64_t> spin_waits;
+    std::atomic<uint64_t> parks;
+    std::atomic<uint64_t> wakes;
+};
+
+// single-writer counter: a relaxed load and store, no locked read-modify-write on the wait path
+static inline void slot_count(std::atomic<uint64_t>* c) {
+    c->store(c->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+struct ggml_bitnet_team {
+    int n_threads;
+    team_slot* slots;
+    std::vector<std::thread> workers;
+
+    // the current run, published by the go flags
+    ggml_bitnet_team_task task;
+    void* ctx;
+    int nth;
+    bool stop;
+    std::atomic<uint64_t> runs;
+
+    alignas(SYNC_CACHE_LINE) std::atomic<uint32_t> remaining;
+    std::atomic<uint32_t> join_parked;
+
+    alignas(SYNC_CACHE_LINE) std::atomic<uint32_t> barrier_count;
+    alignas(SYNC_CACHE_LINE) std::atomic<uint32_t> barrier_gen;
+    std::atomic<uint32_t> barrier_parked;
+    std::atomic<uint64_t> barriers;
+};
+
+// slot of the calling thread in the team it is running for
+static thread_local team_slot* tl_slot = NULL;
+
+/* ========================================================================== */
+/* Spin-Then-Park Wait                                                        */
+/* ========================================================================== */
+
+/**
+ * Wait until *addr != old. Spins for the slot's budget, then counts itself
+ * in *parked and sleeps on the futex. The waker stores the new value
+ * first and then checks *parked (both sequentially consistent), so either
+ * this thread sees the value or the waker sees it parked.
+ */
+static uint32_t sync_wait_change(std::atomic<uint32_t>* addr, uint32_t old,
+                                 std::atomic<uint32_t>* parked, team_slot* slot) {
+    slot_count(&slot->waits);
+    uint32_t v = addr->load(std::memory_order_acquire);
+    if (v != old) {
+        slot_count(&slot->spin_waits);
+        return v;
+    }
+
+    const uint64_t start = ggml_bitnet_rt_now_ns();
+    const uint64_t budget = slot->spin_ns;
+    for (uint32_t i = 1; budget > 0; i++) {
+        sync_relax();
+        v = addr->load(std::memory_order_acquire);
+        if (v != old) {
+            slot_count(&slot->spin_waits);
+            return v;
+        }
+        // the clock is slower than a poll, read it every 64 polls
+        if ((i & 63) == 0 && ggml_bitnet_rt_now_ns() - start >= budget) {
+            break;
+        }
+    }
+
+    slot_count(&slot->parks);
+    parked->fetch_add(1, std::memory_order_seq_cst);
+    while ((v = addr->load(std::memory_order_seq_cst)) == old) {
+        sync_futex_wait(addr, old);
+    }
+    parked->fetch_sub(1, std::memory_order_relaxed);
+
+    // adapt: a park just past the budget means spinning longer would have paid off,
+    // a long wait means the team is idle and spinning only burns the core
+    const uint64_t waited = ggml_bitnet_rt_now_ns() - start;
+    if (slot->spin_max_ns == 0) {
+        return v;
+    }
+    if (waited < 2 * slot->spin_max_ns) {
+        slot->spin_ns = budget * 2 < slot->spin_max_ns ? budget * 2 : slot->spin_max_ns;
+    } else {
+        slot->spin_ns = budget / 2 > GGML_BITNET_SYNC_SPIN_MIN_NS ? budget / 2 : GGML_BITNET_SYNC_SPIN_MIN_NS;
+    }
+    return v;
+}
+
+static void sync_publish(std::atomic<uint32_t>* addr, uint32_t v, std::atomic<uint32_t>* parked, team_slot* slot) {
+    addr->store(v, std::memory_order_seq_cst);
+    if (parked->load(std::memory_order_seq_cst) != 0) {
+        slot_count(&slot->wakes);
+        sync_futex_wake(addr);
+    }
+}
+
+/* ========================================================================== */
+/* Team                                                                       */
+/* ========================================================================== */
+
+static void team_worker(ggml_bitnet_team* team, int ith) {
+    team_slot* slot = &team->slots[ith];
+    tl_slot = slot;
+    uint32_t seen = 0;
+    for (;;) {
+        seen = sync_wait_change(&slot->go, seen, &slot->parked, slot);
+        if (team->stop) {
+            return;
+        }
+        team->task(team->ctx, ith, team->nth);
+        if (team->remaining.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+            team->join_parked.load(std::memory_order_seq_cst) != 0) {
+            slot_count(&slot->wakes);
+            sync_futex_wake(&team->remaining);
+        }
+    }
+}
+
+// cores this process may run on
+static int sync_available_cores(void) {
+#if defined(__linux__)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        return CPU_COUNT(&set);
+    }
+#endif
+    const unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? (int)n : 1;
+}
+
+struct ggml_bitnet_team* ggml_bitnet_team_create(int n_threads) {
+    if (n_threads < 1) {
+        return NULL;
+    }
+    ggml_bitnet_team* team = new (std::nothrow) ggml_bitnet_team();
+    if (team == NULL) {
+        return NULL;
+    }
+    team->n_threads = n_threads;
+    team->slots = new (std::nothrow) team_slot[n_threads];
+    if (team->slots == NULL) {
+        delete team;
+        return NULL;
+    }
+    // with more threads than cores a spinner holds the core its waker needs: park at once
+    const bool spin = n_threads <= sync_available_cores();
+    for (int i = 0; i < n_threads; i++) {
+        team_slot* s = &team->slots[i];
+        s->go.store(0, std::memory_order_relaxed);
+        s->parked.store(0, std::memory_order_relaxed);
+        s->spin_ns = spin ? GGML_BITNET_SYNC_SPIN_INIT_NS : 0;
+        s->spin_max_ns = spin ? GGML_BITNET_SYNC_SPIN_MAX_NS : 0;
+        s->waits.store(0, std::memory_order_relaxed);
+        s->spin_waits.store(0, std::memory_order_relaxed);
+        s->parks.store(0, std::memory_order_relaxed);
+        s->wakes.store(0, std::memory_order_relaxed);
+    }
+    team->task = NULL;
+    team->ctx = NULL;
+    team->nth = 1;
+    team->stop = false;
+    team->runs.store(0, std::memory_order_relaxed);
+    team->remaining.store(0, std::memory_order_relaxed);
+    team->join_parked.store(0, std::memory_order_relaxed);
+    team->barrier_count.store(0, std::memory_order_relaxed);
+    team->barrier_gen.store(0, std::memory_order_relaxed);
+    team->barrier_parked.store(0, std::memory_order_relaxed);
+    team->barriers.store(0, std::memory_order_relaxed);
+
+    try {
+        for (int i = 1; i < n_threads; i++) {
+            team->workers.emplace_back(team_worker, team, i);
+        }
+    } catch (...) {
+        // std::system_error when the OS refuses a thread: stop and join the ones already running
+        ggml_bitnet_team_free(team);
+        return NULL;
+    }
+    return team;
+}
+
+void ggml_bitnet_team_free(struct ggml_bitnet_team* team) {
+    if (team == NULL) {
+        return;
+    }
+    team->stop = true;
+    for (int i = 1; i < team->n_threads; i++) {
+        team_slot* s = &team->slots[i];
+        sync_publish(&s->go, s->go.load(std::memory_order_relaxed) + 1, &s->parked, &team->slots[0]);
+    }
+    for (auto& w : team->workers) {
+        w.join();
+    }
+    delete[] team->slots;
+    delete team;
+}
+
+int ggml_bitnet_team_size(const struct ggml_bitnet_team* team) {
+    return team->n_threads;
+}
+
+void ggml_bitnet_team_run(struct ggml_bitnet_team* team, ggml_bitnet_team_task task, void* ctx, int nth) {
+    if (nth > team->n_threads) nth = team->n_threads;
+    if (nth < 1) nth = 1;
+    team_slot* master = &team->slots[0];
+    team_slot* outer = tl_slot;
+    tl_slot = master;
+    team->runs.store(team->runs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    team->task = task;
+    team->ctx = ctx;
+    team->nth = nth;
+    team->remaining.store((uint32_t)(nth - 1), std::memory_order_relaxed);
+    // the seq_cst go store publishes task, ctx, nth and remaining with it
+    for (int i = 1; i < nth; i++) {
+        team_slot* s = &team->slots[i];
+        sync_publish(&s->go, s->go.load(std::memory_order_relaxed) + 1, &s->parked, master);
+    }
+
+    task(ctx, 0, nth);
+
+    uint32_t r = team->remaining.load(std::memory_order_acquire);
+    while (r != 0) {
+        r = sync_wait_change(&team->remaining, r, &team->join_parked, master);
+    }
+    tl_slot = outer;
+}
+
+void ggml_bitnet_team_barrier(struct ggml_bitnet_team* team) {
+    if (team->nth <= 1) {
+        return;
+    }
+    team_slot* slot = tl_slot != NULL ? tl_slot : &team->slots[0];
+    const uint32_t gen = team->barrier_gen.load(std::memory_order_acquire);
+    if (team->barrier_count.fetch_add(1, std::memory_order_acq_rel) == (uint32_t)team->nth - 1) {
+        // last to arrive: no one else can re-enter before the generation moves
+        team->barrier_count.store(0, std::memory_order_relaxed);
+        team->barriers.fetch_add(1, std::memory_order_relaxed);
+        sync_publish(&team->barrier_gen, gen + 1, &team->barrier_parked, slot);
+        return;
+    }
+    sync_wait_change(&team->barrier_gen, gen, &team->barrier_parked, slot);
+}
+
+void ggml_bitnet_team_get_stats(const struct ggml_bitnet_team* team, struct ggml_bitnet_team_stats* stats) {
+    stats->runs = team->runs.load(std::memory_order_relaxed);
+    stats->barriers = team->barriers.load(std::memory_order_relaxed);
+    stats->waits = stats->spin_waits = stats->parks = stats->wakes = 0;
+    for (int i = 0; i < team->n_threads; i++) {
+        const team_slot* s = &team->slots[i];
+        stats->waits += s->waits.load(std::memory_order_relaxed);
+        stats->spin_waits += s->spin_waits.load(std::memory_order_relaxed);
+        stats->parks += s->parks.load(std::memory_order_relaxed);
+        stats->wakes += s->wakes.load(std::memory_order_relaxed);
+    }
+}
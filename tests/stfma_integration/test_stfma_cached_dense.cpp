@@ -0,0 +1,166 @@
+/**
+ * Differential test for the cached STFMA inference path
+ * 
+ * Packs random ternary weights in the I2_S layout produced by quantize_i2_s,
+ * caches them through ggml_bitnet_stfma_cache_weights, and checks that every
+ * dense kernel variant (AVX2, AVX-512, dispatched cached path) and the
+ * uncached ggml_vec_dot_i2_i8_stfma that ggml_vec_dot_i2_i8_s dispatches to
+ * match ggml_bitnet_ref_vec_dot_i2_i8_s.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstring>
+
+extern "C" {
+    #include "ggml-bitnet-stfma.h"
+    #include "ggml-bitnet-stfma-cache.h"
+    #include "ggml-bitnet-stfma-avx2.h"
+    #include "ggml-bitnet-stfma-avx512.h"
+}
+#include "ggml-bitnet-pack.h"
+
+static bool test_cached(int n, std::mt19937& gen) {
+    std::uniform_int_distribution<> trit_dis(-1, 1);
+    std::uniform_int_distribution<> act_dis(-128, 127);
+    
+    std::vector<int8_t> w(n);
+    std::vector<int8_t> y(n);
+    std::vector<int32_t> y32(n);
+    int32_t act_sum = 0;
+    for (int i = 0; i < n; i++) {
+        w[i] = trit_dis(gen);
+        y[i] = act_dis(gen);
+        y32[i] = y[i];
+        act_sum += y[i];
+    }
+    
+    std::vector<uint8_t> packed(n / 4);
+    ggml_bitnet_pack_i2_s(w.data(), packed.data(), n);
+    
+    int32_t expected = ggml_bitnet_ref_vec_dot_i2_i8_s(packed.data(), y.data(), n);
+    
+    ggml_bitnet_stfma_cache_handle handle = ggml_bitnet_stfma_cache_weights(packed.data(), n);
+    if (!handle) {
+        std::cout << "  ✗ n = " << n << ": caching failed" << std::endl;
+        return false;
+    }
+#if defined(__AVX2__) || defined(__AVX512F__)
+    const uint8_t* stfma = ggml_bitnet_stfma_get_cached_weights(handle);
+#endif
+    
+    bool passed = true;
+    
+    float cached = 0.0f;
+    ggml_vec_dot_i2_i8_s_stfma_cached(n, &cached, handle, y.data());
+    if ((int32_t)cached != expected) {
+        std::cout << "  ✗ n = " << n << ": cached " << cached << " != " << expected << std::endl;
+        passed = false;
+    }
+    
+    // the entry point ggml_vec_dot_i2_i8_s takes for rows at or above GGML_BITNET_STFMA_THRESHOLD
+    float jit = 0.0f;
+    ggml_vec_dot_i2_i8_stfma(n, &jit, 0, packed.data(), 0, y.data(), 0, 1);
+    if ((int32_t)jit != expected) {
+        std::cout << "  ✗ n = " << n << ": ggml_vec_dot_i2_i8_stfma " << jit << " != " << expected << std::endl;
+        passed = false;
+    }
+    
+#if defined(__AVX2__)
+    int32_t avx2 = ggml_bitnet_stfma_dense_avx2(stfma, y32.data(), n) + act_sum;
+    if (avx2 != expected) {
+        std::cout << "  ✗ n = " << n << ": AVX2 " << avx2 << " != " << expected << std::endl;
+        passed = false;
+    }
+#endif
+    
+#if defined(__AVX512F__)
+    int32_t avx512 = ggml_bitnet_stfma_dense_avx512_tail(stfma, y32.data(), n) + act_sum;
+    if (avx512 != expected) {
+        std::cout << "  ✗ n = " << n << ": AVX-512 " << avx512 << " != " << expected << std::endl;
+        passed = false;
+    }
+#endif
+    
+    ggml_bitnet_stfma_free_cached_weights(handle);
+    
+    if (passed) {
+        std::cout << "  ✓ n = " << n << std::endl;
+    }
+    return passed;
+}
+
+// Lengths that are not multiples of the SIMD width exercise the kernel tails
+static bool test_dense_tail(size_t n, std::mt19937& gen) {
+    static const int32_t decode[4] = {0, 1, -1, 0};
+    std::uniform_int_distribution<> byte_dis(0, 255);
+    std::uniform_int_distribution<> act_dis(-128, 127);
+    
+    std::vector<uint8_t> w((n + 3) / 4 + 4);
+    std::vector<int32_t> a(n);
+    for (auto& b : w) b = byte_dis(gen);
+    for (auto& v : a) v = act_dis(gen);
+    
+    int32_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t trit = (w[i / 4] >> ((i % 4) * 2)) & 0x3;
+        if (stfma_decode_trit(trit) != decode[trit]) {
+            std::cout << "  ✗ stfma_decode_trit(" << (int)trit << ") is wrong" << std::endl;
+            return false;
+        }
+        expected += decode[trit] * a[i];
+    }
+    
+    bool passed = true;
+    // the element-wise FMA decodes with the same rule
+    std::vector<int32_t> c(n, 1);
+    sparse_ternary_fma_int32(a.data(), w.data(), c.data(), n);
+    for (size_t i = 0; i < n; i++) {
+        uint8_t trit = (w[i / 4] >> ((i % 4) * 2)) & 0x3;
+        if (c[i] != 1 + decode[trit] * a[i]) {
+            std::cout << "  ✗ sparse_ternary_fma_int32, n = " << n << ", element " << i << std::endl;
+            passed = false;
+            break;
+        }
+    }
+#if defined(__AVX2__)
+    if (ggml_bitnet_stfma_dense_avx2(w.data(), a.data(), n) != expected) {
+        std::cout << "  ✗ AVX2 tail, n = " << n << std::endl;
+        passed = false;
+    }
+#endif
+#if defined(__AVX512F__)
+    if (ggml_bitnet_stfma_dense_avx512_tail(w.data(), a.data(), n) != expected) {
+        std::cout << "  ✗ AVX-512 tail, n = " << n << std::endl;
+        passed = false;
+    }
+#endif
+    if (passed) {
+        std::cout << "  ✓ tail n = " << n << std::endl;
+    }
+    return passed;
+}
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Cached STFMA vs ggml_vec_dot_i2_i8_s" << std::endl;
+    std::cout << "========================================" << std::endl;
+    
+    std::mt19937 gen(42);
+    int failed = 0;
+    
+    ggml_bitnet_stfma_cache_init();
+    for (int n : {128, 256, 1536, 2560, 4096, 6912, 14336}) {
+        failed += !test_cached(n, gen);
+    }
+    for (size_t n : {1, 7, 15, 17, 33, 64, 100, 1000, 1001}) {
+        failed += !test_dense_tail(n, gen);
+    }
+    ggml_bitnet_stfma_cache_shutdown();
+    stfma_free_buffers();
+    
+    std::cout << "========================================" << std::endl;
+    std::cout << (failed == 0 ? "All tests passed" : "Some tests FAILED") << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -32,15 +32,16 @@ void generate_random_ternary(std::vector<int8_t>& trits, size_t n) {
     }
 }
 
-// Helper function to pack ternary values in BitNet format
+// Helper function to pack ternary values in the I2_S layout of quantize_i2_s:
+// each 128-element block is 32 bytes, element j of the block in bits 6 - 2 * (j / 32) of byte j % 32
 void pack_bitnet_format(const std::vector<int8_t>& trits, std::vector<uint8_t>& packed) {
     size_t n = trits.size();
     size_t num_bytes = n / 4;
     packed.resize(num_bytes);
     
     for (size_t i = 0; i < n; i++) {
-        size_t byte_idx = i / 4;
-        size_t bit_offset = (i % 4) * 2;
+        size_t byte_idx = i / 128 * 32 + i % 32;
+        size_t bit_offset = 6 - 2 * (i % 128 / 32);
         
         uint8_t encoded;
         if (trits[i] == -1) encoded = 0;
@@ -76,10 +77,11 @@ bool test_integration(size_t n) {
     std::vector<uint8_t> packed_trits(n / 4, 0);
     pack_bitnet_format(trits, packed_trits);
     
-    // Compute reference result (manual calculation)
+    // Compute reference result (manual calculation), in the sum((w + 1) * y)
+    // convention of ggml_vec_dot_i2_i8_s
     int64_t reference_sum = 0;
     for (size_t i = 0; i < n; i++) {
-        reference_sum += (int64_t)trits[i] * (int64_t)activations[i];
+        reference_sum += (int64_t)(trits[i] + 1) * (int64_t)activations[i];
     }
     float reference_result = (float)reference_sum;
     
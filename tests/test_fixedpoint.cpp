@@ -0,0 +1,298 @@
+/**
+ * Test for the integer-domain inter-layer pipeline
+ *
+ * Checks scale arithmetic, integer requantization against the float absmax
+ * rule, the integer ReLU^2 and RMSNorm against double references, the
+ * ternary matmul on the ggml_vec_dot_i2_i8_s dispatch of the build (exact,
+ * against int loops over the unpacked trits), and runs a BitNet FFN block
+ * against both the float path and an independent double reference.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "ggml-bitnet-fixedpoint.h"
+#include "ggml-bitnet-pack.h"
+
+static int failures = 0;
+
+#define CHECK(cond, msg) \
+    do { \
+        if (!(cond)) { \
+            std::cout << "  ✗ " << msg << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+static std::mt19937 rng(11);
+
+// n_rows ternary rows of n in the I2_S layout
+static std::vector<uint8_t> pack_i2_s(const std::vector<int8_t>& w, int n_rows, int n) {
+    std::vector<uint8_t> packed((size_t)n_rows * n / 4);
+    for (int r = 0; r < n_rows; r++) {
+        ggml_bitnet_pack_i2_s(w.data() + (size_t)r * n, packed.data() + (size_t)r * n / 4, n);
+    }
+    return packed;
+}
+
+static void test_scales() {
+    std::cout << "Scale arithmetic..." << std::endl;
+    std::uniform_real_distribution<double> dist(-30.0, 30.0);
+    for (int i = 0; i < 1000; i++) {
+        const double a = exp2(dist(rng)), b = exp2(dist(rng));
+        ggml_bitnet_fx_scale sa = ggml_bitnet_fx_scale_from_float(a);
+        ggml_bitnet_fx_scale sb = ggml_bitnet_fx_scale_from_float(b);
+        CHECK(sa.m >= (1 << 30), "scale is not normalized");
+        CHECK(fabs(ggml_bitnet_fx_scale_to_float(sa) / a - 1.0) < 1e-9, "round trip of " << a);
+        const double ab = ggml_bitnet_fx_scale_to_float(ggml_bitnet_fx_scale_mul(sa, sb));
+        CHECK(fabs(ab / (a * b) - 1.0) < 1e-8, "product of " << a << " and " << b);
+    }
+    // a float weight scale must survive exactly
+    const float w = 0.0137f;
+    CHECK((float)ggml_bitnet_fx_scale_to_float(ggml_bitnet_fx_scale_from_float(w)) == w, "float scale not exact");
+}
+
+static void test_requantize() {
+    std::cout << "Integer requantization..." << std::endl;
+    const int sizes[] = {7, 32, 100, 2560, 6912};
+    const int ranges[] = {3, 200, 40000, 3000000};
+    for (int n : sizes) {
+        for (int range : ranges) {
+            std::uniform_int_distribution<int32_t> dist(-range, range);
+            std::vector<int32_t> acc(n);
+            for (auto& a : acc) a = dist(rng);
+            const ggml_bitnet_fx_scale s_acc = ggml_bitnet_fx_scale_from_float(0.001);
+
+            std::vector<int8_t> q(n);
+            ggml_bitnet_fx_scale s_q;
+            const int32_t sum = ggml_bitnet_fx_requantize_i32(acc.data(), n, s_acc, q.data(), &s_q);
+
+            // float path: dequantize, then absmax to 127
+            std::vector<float> f(n);
+            ggml_bitnet_fx_dequantize_i32(acc.data(), n, s_acc, f.data());
+            std::vector<int8_t> q_ref(n);
+            ggml_bitnet_fx_scale s_ref;
+            ggml_bitnet_fx_quantize_f32(f.data(), n, q_ref.data(), &s_ref);
+
+            int32_t sum_check = 0, mismatches = 0;
+            for (int i = 0; i < n; i++) {
+                CHECK(abs(q[i] - q_ref[i]) <= 1, "q differs by more than 1 (n=" << n << " range=" << range << ")");
+                mismatches += q[i] != q_ref[i];
+                sum_check += q[i];
+            }
+            CHECK(sum == sum_check, "sum of q");
+            CHECK(mismatches * 50 <= n + 50, "too many rounding differences (" << mismatches << " of " << n << ")");
+            const double rel = ggml_bitnet_fx_scale_to_float(s_q) / ggml_bitnet_fx_scale_to_float(s_ref) - 1.0;
+            CHECK(fabs(rel) < 1e-6, "scale differs from the float path by " << rel);
+        }
+    }
+}
+
+static void test_elementwise() {
+    std::cout << "ReLU^2 and RMSNorm..." << std::endl;
+    const int n = 1000;
+    std::uniform_int_distribution<int32_t> dist(-5000000, 5000000);
+    std::vector<int32_t> gate(n), up(n), out(n);
+    for (int i = 0; i < n; i++) {
+        gate[i] = dist(rng);
+        up[i] = dist(rng);
+    }
+    const ggml_bitnet_fx_scale s_gate = ggml_bitnet_fx_scale_from_float(3e-5);
+    const ggml_bitnet_fx_scale s_up = ggml_bitnet_fx_scale_from_float(7e-6);
+
+    ggml_bitnet_fx_scale s_out;
+    ggml_bitnet_fx_relu2_mul_i32(gate.data(), s_gate, up.data(), s_up, n, out.data(), &s_out);
+
+    double max_ref = 0.0, max_err = 0.0;
+    std::vector<float> ref(n);
+    for (int i = 0; i < n; i++) {
+        const double g = std::max(gate[i], 0) * 3e-5, u = up[i] * 7e-6;
+        ref[i] = (float)(g * g * u);
+        max_ref = std::max(max_ref, fabs((double)ref[i]));
+        max_err = std::max(max_err, fabs(out[i] * ggml_bitnet_fx_scale_to_float(s_out) - ref[i]));
+    }
+    CHECK(max_err < 1e-3 * max_ref, "relu2 error " << max_err << " of " << max_ref);
+
+    std::vector<float> gamma_f(n);
+    std::uniform_real_distribution<float> gdist(0.5f, 2.0f);
+    for (auto& g : gamma_f) g = gdist(rng);
+    std::vector<int16_t> gamma(n);
+    ggml_bitnet_fx_scale s_gamma;
+    ggml_bitnet_fx_quantize_i16(gamma_f.data(), n, gamma.data(), &s_gamma);
+
+    double sumsq = 0.0;
+    for (int i = 0; i < n; i++) sumsq += (double)ref[i] * ref[i];
+    const double rms = sqrt(sumsq / n + 1e-6);
+
+    ggml_bitnet_fx_rmsnorm_i32(out.data(), n, &s_out, gamma.data(), s_gamma, 1e-6f);
+    double err2 = 0.0, ref2 = 0.0;
+    for (int i = 0; i < n; i++) {
+        const double r = ref[i] / rms * gamma_f[i];
+        const double e = out[i] * ggml_bitnet_fx_scale_to_float(s_out) - r;
+        err2 += e * e;
+        ref2 += r * r;
+    }
+    CHECK(sqrt(err2 / ref2) < 1e-3, "rmsnorm relative error " << sqrt(err2 / ref2));
+}
+
+static std::vector<int8_t> random_trits(size_t n) {
+    std::uniform_int_distribution<int> dist(-1, 1);
+    std::vector<int8_t> w(n);
+    for (auto& v : w) v = (int8_t)dist(rng);
+    return w;
+}
+
+// exact ternary reference: plain int loops over the unpacked trits
+static void ref_mul_mat(int n, int m, const std::vector<int8_t>& w, const int8_t* q, int32_t* acc) {
+    for (int r = 0; r < m; r++) {
+        acc[r] = ggml_bitnet_ref_dot_ternary(w.data() + (size_t)r * n, q, n);
+    }
+}
+
+static void test_mul_mat() {
+    std::cout << "Ternary matmul..." << std::endl;
+    // production row lengths, on both sides of GGML_BITNET_STFMA_THRESHOLD
+    const int sizes[] = {128, 640, 2560, 6912};
+    const int m = 64;
+    std::uniform_int_distribution<int> qdist(-127, 127);
+    for (int n : sizes) {
+        const std::vector<int8_t> w = random_trits((size_t)m * n);
+        const std::vector<uint8_t> packed = pack_i2_s(w, m, n);
+        std::vector<int8_t> q(n);
+        int32_t q_sum = 0;
+        for (auto& v : q) {
+            v = (int8_t)qdist(rng);
+            q_sum += v;
+        }
+
+        std::vector<int32_t> acc(m), ref(m);
+        ggml_bitnet_fx_mul_mat_i2_s(n, m, packed.data(), q.data(), q_sum, acc.data());
+        ref_mul_mat(n, m, w, q.data(), ref.data());
+        for (int r = 0; r < m; r++) {
+            CHECK(acc[r] == ref[r], "n=" << n << " row " << r << ": " << acc[r] << " != " << ref[r]);
+        }
+    }
+}
+
+// the FFN block in double from the unpacked trits, sharing no code with the library
+static void ref_ffn(int n_embd, int n_ff, const std::vector<int8_t>& wg, const std::vector<int8_t>& wu,
+                    const std::vector<int8_t>& wd, double s_gate, double s_up, double s_down,
+                    const std::vector<float>& norm, double eps, const std::vector<float>& x, std::vector<double>& y) {
+    // absmax int8 quantization, as the kernels feed every matmul
+    auto quantize = [](const std::vector<double>& v, std::vector<int8_t>& q) {
+        double amax = 0.0;
+        for (double a : v) amax = std::max(amax, fabs(a));
+        const double s = amax / 127.0;
+        q.resize(v.size());
+        for (size_t i = 0; i < v.size(); i++) q[i] = (int8_t)(s > 0.0 ? nearbyint(v[i] / s) : 0.0);
+        return s;
+    };
+
+    std::vector<int8_t> q;
+    const double s_x = quantize(std::vector<double>(x.begin(), x.end()), q);
+    std::vector<int32_t> g(n_ff), u(n_ff), d(n_embd);
+    ref_mul_mat(n_embd, n_ff, wg, q.data(), g.data());
+    ref_mul_mat(n_embd, n_ff, wu, q.data(), u.data());
+
+    std::vector<double> h(n_ff);
+    double sumsq = 0.0;
+    for (int i = 0; i < n_ff; i++) {
+        const double gi = std::max(g[i] * s_x * s_gate, 0.0);
+        h[i] = gi * gi * u[i] * s_x * s_up;
+        sumsq += h[i] * h[i];
+    }
+    const double inv_rms = 1.0 / sqrt(sumsq / n_ff + eps);
+    for (int i = 0; i < n_ff; i++) h[i] *= inv_rms * norm[i];
+
+    const double s_h = quantize(h, q);
+    ref_mul_mat(n_ff, n_embd, wd, q.data(), d.data());
+    y.resize(n_embd);
+    for (int i = 0; i < n_embd; i++) y[i] = d[i] * s_h * s_down;
+}
+
+static void test_ffn() {
+    std::cout << "BitNet FFN block..." << std::endl;
+    // long enough rows to take the STFMA dispatch of ggml_vec_dot_i2_i8_s where it is built
+    const int n_embd = 1024, n_ff = 2816;
+
+    const std::vector<int8_t> wg = random_trits((size_t)n_ff * n_embd);
+    const std::vector<int8_t> wu = random_trits((size_t)n_ff * n_embd);
+    const std::vector<int8_t> wd = random_trits((size_t)n_embd * n_ff);
+    std::vector<uint8_t> gate = pack_i2_s(wg, n_ff, n_embd);
+    std::vector<uint8_t> up = pack_i2_s(wu, n_ff, n_embd);
+    std::vector<uint8_t> down = pack_i2_s(wd, n_embd, n_ff);
+
+    std::vector<float> norm_f(n_ff);
+    std::uniform_real_distribution<float> gdist(0.2f, 3.0f);
+    for (auto& g : norm_f) g = gdist(rng);
+    std::vector<int16_t> norm(n_ff);
+
+    ggml_bitnet_fx_ffn ffn;
+    ffn.n_embd = n_embd;
+    ffn.n_ff = n_ff;
+    ffn.gate = gate.data();
+    ffn.up = up.data();
+    ffn.down = down.data();
+    ffn.s_gate = ggml_bitnet_fx_scale_from_float(0.8f);
+    ffn.s_up = ggml_bitnet_fx_scale_from_float(1.3f);
+    ffn.s_down = ggml_bitnet_fx_scale_from_float(0.05f);
+    ggml_bitnet_fx_quantize_i16(norm_f.data(), n_ff, norm.data(), &ffn.s_sub_norm);
+    ffn.sub_norm = norm.data();
+    ffn.sub_norm_f32 = norm_f.data();
+    ffn.eps = 1e-5f;
+
+    std::vector<uint8_t> work(ggml_bitnet_fx_ffn_work_size(&ffn));
+    ggml_bitnet_fx_report report;
+    ggml_bitnet_fx_report_reset(&report);
+
+    std::normal_distribution<float> xdist(0.0f, 1.0f);
+    std::vector<float> x(n_embd), y(n_embd), y2(n_embd);
+    std::vector<double> y_ref;
+    double err2 = 0.0, ref2 = 0.0;
+    for (int token = 0; token < 32; token++) {
+        for (auto& v : x) v = xdist(rng);
+        ggml_bitnet_fx_ffn_forward(&ffn, x.data(), y.data(), work.data(), &report);
+        // the report must not change the result
+        ggml_bitnet_fx_ffn_forward(&ffn, x.data(), y2.data(), work.data(), nullptr);
+        CHECK(memcmp(y.data(), y2.data(), n_embd * sizeof(float)) == 0, "report changed the output");
+
+        ref_ffn(n_embd, n_ff, wg, wu, wd, 0.8, 1.3, 0.05, norm_f, ffn.eps, x, y_ref);
+        for (int i = 0; i < n_embd; i++) {
+            err2 += (y[i] - y_ref[i]) * (y[i] - y_ref[i]);
+            ref2 += y_ref[i] * y_ref[i];
+        }
+    }
+    // the float path of the report shares the matmul with the integer path, this bound does not
+    CHECK(sqrt(err2 / ref2) < 2e-2, "output relative error against the double reference " << sqrt(err2 / ref2));
+
+    ggml_bitnet_fx_report_print(&report, stdout);
+    CHECK(report.n_layers == 5, "expected 5 layers in the report");
+    const double bounds[] = {1e-6, 1e-6, 1e-3, 1e-3, 2e-2};
+    for (int i = 0; i < report.n_layers && i < 5; i++) {
+        const double rel = ggml_bitnet_fx_layer_rel_error(&report.layers[i]);
+        CHECK(report.layers[i].tokens == 32, report.layers[i].name << " token count");
+        CHECK(rel < bounds[i], report.layers[i].name << " relative error " << rel << " above " << bounds[i]);
+    }
+}
+
+int main() {
+    std::cout << "Integer-Domain Pipeline Test" << std::endl;
+    std::cout << "============================" << std::endl;
+
+    test_scales();
+    test_requantize();
+    test_elementwise();
+    test_mul_mat();
+    test_ffn();
+
+    if (failures == 0) {
+        std::cout << "\n✓ All tests passed" << std::endl;
+        return 0;
+    }
+    std::cout << "\n✗ " << failures << " checks failed" << std::endl;
+    return 1;
+}
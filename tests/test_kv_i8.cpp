@@ -0,0 +1,246 @@
+/**
+ * Test for the int8 KV cache
+ *
+ * Checks the block layout, the quantize/dequantize round trip, the int8
+ * block dot against a scalar reference (build once per ISA to cover the
+ * scalar, AVX2 and NEON paths), the requantization of a transposed V block
+ * when a new token widens its scale, and the int8 decode attention against
+ * float attention over the original K and V.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+#include "ggml-bitnet.h"
+
+static int failures = 0;
+
+#define CHECK(cond, msg) \
+    do { \
+        if (!(cond)) { \
+            std::cout << "  ✗ " << msg << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+static std::mt19937 rng(5);
+
+static std::vector<float> random_row(int n, float scale) {
+    std::normal_distribution<float> dist(0.0f, scale);
+    std::vector<float> x(n);
+    for (auto& v : x) v = dist(rng);
+    return x;
+}
+
+static const char* kv_path() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+static void test_layout() {
+    std::cout << "Block layout..." << std::endl;
+    // same layout as Q8_0: f16 scale, then the int8 values
+    CHECK(sizeof(bitnet_kv_block_i8) == 34, "block is " << sizeof(bitnet_kv_block_i8) << " bytes, not 34");
+    CHECK(offsetof(bitnet_kv_block_i8, qs) == 2, "values do not follow the f16 scale");
+}
+
+static void test_round_trip() {
+    std::cout << "Quantize/dequantize round trip..." << std::endl;
+    const int n = 8 * BITNET_QK_KV;
+    const float scales[] = {1e-3f, 1.0f, 40.0f};
+    for (float scale : scales) {
+        std::vector<float> x = random_row(n, scale), y(n);
+        std::vector<bitnet_kv_block_i8> q(n / BITNET_QK_KV);
+        ggml_bitnet_kv_quantize_row_i8(x.data(), q.data(), n);
+        ggml_bitnet_kv_dequantize_row_i8(q.data(), y.data(), n);
+        for (int b = 0; b < n / BITNET_QK_KV; b++) {
+            float amax = 0.0f;
+            for (int j = 0; j < BITNET_QK_KV; j++) amax = fmaxf(amax, fabsf(x[b * BITNET_QK_KV + j]));
+            // half a step plus the f16 rounding of the scale, carried by |q| <= 127
+            const float bound = 0.5f * amax / 127.0f + amax * 1e-3f;
+            for (int j = 0; j < BITNET_QK_KV; j++) {
+                const int i = b * BITNET_QK_KV + j;
+                CHECK(fabsf(x[i] - y[i]) <= bound, "value " << i << " at scale " << scale << ": " << x[i] << " -> " << y[i]);
+            }
+        }
+    }
+
+    // an all-zero block has a zero scale and decodes to zeros
+    std::vector<float> zeros(BITNET_QK_KV, 0.0f), out(BITNET_QK_KV, 1.0f);
+    bitnet_kv_block_i8 zb;
+    ggml_bitnet_kv_quantize_row_i8(zeros.data(), &zb, BITNET_QK_KV);
+    ggml_bitnet_kv_dequantize_row_i8(&zb, out.data(), BITNET_QK_KV);
+    for (float v : out) CHECK(v == 0.0f, "zero block decodes to " << v);
+}
+
+// the same sum as ggml_bitnet_kv_vec_dot_i8, from the stored blocks
+static double ref_vec_dot(int n, const bitnet_kv_block_i8* x, const bitnet_kv_block_i8* y) {
+    double sum = 0.0;
+    for (int b = 0; b < n / BITNET_QK_KV; b++) {
+        int sumi = 0;
+        for (int j = 0; j < BITNET_QK_KV; j++) sumi += x[b].qs[j] * y[b].qs[j];
+        sum += (double)ggml_fp16_to_fp32(x[b].d) * ggml_fp16_to_fp32(y[b].d) * sumi;
+    }
+    return sum;
+}
+
+static void test_vec_dot() {
+    std::cout << "Block dot (" << kv_path() << " path)..." << std::endl;
+    const int sizes[] = {BITNET_QK_KV, 3 * BITNET_QK_KV, 128, 2048};
+    for (int n : sizes) {
+        for (int iter = 0; iter < 20; iter++) {
+            std::vector<float> a = random_row(n, 2.0f), b = random_row(n, 0.5f);
+            std::vector<bitnet_kv_block_i8> qa(n / BITNET_QK_KV), qb(n / BITNET_QK_KV);
+            ggml_bitnet_kv_quantize_row_i8(a.data(), qa.data(), n);
+            ggml_bitnet_kv_quantize_row_i8(b.data(), qb.data(), n);
+            // saturate a few values so the extremes of maddubs/vdot are exercised
+            qa[0].qs[0] = 127; qb[0].qs[0] = -127;
+            qa[0].qs[1] = -127; qb[0].qs[1] = -127;
+
+            const double ref = ref_vec_dot(n, qa.data(), qb.data());
+            double mag = 0.0;
+            for (int i = 0; i < n / BITNET_QK_KV; i++) {
+                mag += fabs((double)ggml_fp16_to_fp32(qa[i].d) * ggml_fp16_to_fp32(qb[i].d)) * 127 * 127 * BITNET_QK_KV;
+            }
+            const float got = ggml_bitnet_kv_vec_dot_i8(n, qa.data(), qb.data());
+            CHECK(fabs(got - ref) <= 1e-6 * mag, "n=" << n << ": " << got << " vs reference " << ref);
+        }
+    }
+}
+
+static void test_store_v() {
+    std::cout << "Transposed V store and requantization..." << std::endl;
+    const int head_dim = BITNET_QK_KV, n_ctx = 2 * BITNET_QK_KV, nb_ctx = n_ctx / BITNET_QK_KV;
+    std::vector<bitnet_kv_block_i8> vt(head_dim * nb_ctx);
+    std::vector<std::vector<float>> tokens;
+
+    // four small tokens, then one that widens every channel's scale 20x
+    for (int pos = 0; pos < 5; pos++) {
+        tokens.push_back(random_row(head_dim, pos < 4 ? 0.1f : 2.0f));
+        for (auto& v : tokens.back()) v = pos < 4 ? v : copysignf(fabsf(v) + 2.0f, v);
+        ggml_bitnet_kv_store_v_i8(head_dim, n_ctx, vt.data(), pos, tokens.back().data());
+    }
+    for (int c = 0; c < head_dim; c++) {
+        const bitnet_kv_block_i8& b = vt[c * nb_ctx];
+        const float d = ggml_fp16_to_fp32(b.d);
+        float amax = 0.0f;
+        for (int pos = 0; pos < 5; pos++) amax = fmaxf(amax, fabsf(tokens[pos][c]));
+        CHECK(fabsf(d - amax / 127.0f) <= 1e-3f * amax / 127.0f, "channel " << c << " scale " << d << " was not widened to " << amax / 127.0f);
+        for (int pos = 0; pos < 5; pos++) {
+            // one rounding at the old scale, one at the new one
+            const float deq = d * b.qs[pos];
+            CHECK(fabsf(deq - tokens[pos][c]) <= 1.01f * d, "channel " << c << " token " << pos << ": " << tokens[pos][c] << " -> " << deq);
+        }
+        for (int pos = 5; pos < BITNET_QK_KV; pos++) {
+            CHECK(b.qs[pos] == 0, "unwritten token " << pos << " is not zero");
+        }
+    }
+
+    // a new sequence reusing the block must not inherit the wide scale
+    for (int pos = 0; pos < 2; pos++) {
+        const std::vector<float> v = random_row(head_dim, 0.1f);
+        ggml_bitnet_kv_store_v_i8(head_dim, n_ctx, vt.data(), pos, v.data());
+        if (pos == 0) {
+            for (int c = 0; c < head_dim; c++) {
+                // f16 rounding, relative for normal scales, absolute for subnormal ones
+                CHECK(ggml_fp16_to_fp32(vt[c * nb_ctx].d) <= fabsf(v[c]) / 127.0f * 1.001f + 6e-8f, "stale scale kept at the start of a block");
+                CHECK(vt[c * nb_ctx].qs[4] == 0, "stale token kept at the start of a block");
+            }
+        }
+    }
+
+    // tokens of the second block land there and leave the first alone
+    const std::vector<float> v = random_row(head_dim, 1.0f);
+    ggml_bitnet_kv_store_v_i8(head_dim, n_ctx, vt.data(), BITNET_QK_KV + 3, v.data());
+    for (int c = 0; c < head_dim; c++) {
+        const bitnet_kv_block_i8& b = vt[c * nb_ctx + 1];
+        CHECK(fabsf(ggml_fp16_to_fp32(b.d) * b.qs[3] - v[c]) <= 0.51f * ggml_fp16_to_fp32(b.d) + 1e-3f * fabsf(v[c]),
+              "second block token of channel " << c);
+    }
+}
+
+static void test_attention() {
+    std::cout << "Decode attention against float..." << std::endl;
+    const int head_dim = 128, n_ctx = 256, nb_head = head_dim / BITNET_QK_KV, nb_ctx = n_ctx / BITNET_QK_KV;
+    const int cases[][2] = {{1, BITNET_QK_KV}, {100, 128}, {256, 256}};
+    const float scale = 1.0f / sqrtf((float)head_dim);
+
+    for (const auto& cs : cases) {
+        const int n_past = cs[0], n_kv = cs[1];
+        std::vector<float> q = random_row(head_dim, 1.0f);
+        std::vector<std::vector<float>> k, v;
+        std::vector<bitnet_kv_block_i8> kq((size_t)n_ctx * nb_head), vt((size_t)head_dim * nb_ctx);
+        for (int t = 0; t < n_past; t++) {
+            k.push_back(random_row(head_dim, 1.0f));
+            v.push_back(random_row(head_dim, 1.0f));
+            ggml_bitnet_kv_quantize_row_i8(k[t].data(), kq.data() + t * nb_head, head_dim);
+            ggml_bitnet_kv_store_v_i8(head_dim, n_ctx, vt.data(), t, v[t].data());
+        }
+
+        std::vector<float> scores(n_kv), out(head_dim);
+        ggml_bitnet_kv_attn_i8(n_kv, n_past, head_dim, n_ctx, q.data(), kq.data(), vt.data(), scale,
+                               scores.data(), out.data());
+
+        // float attention over the original K and V
+        std::vector<double> w(n_past);
+        double max = -INFINITY, sum = 0.0;
+        for (int t = 0; t < n_past; t++) {
+            double dot = 0.0;
+            for (int c = 0; c < head_dim; c++) dot += (double)q[c] * k[t][c];
+            w[t] = scale * dot;
+            max = std::max(max, w[t]);
+        }
+        for (int t = 0; t < n_past; t++) sum += w[t] = exp(w[t] - max);
+        double err = 0.0, norm = 0.0;
+        for (int c = 0; c < head_dim; c++) {
+            double ref = 0.0;
+            for (int t = 0; t < n_past; t++) ref += w[t] / sum * v[t][c];
+            err += (out[c] - ref) * (out[c] - ref);
+            norm += ref * ref;
+        }
+        const double rel = sqrt(err / norm);
+        CHECK(rel < 0.015, "n_past=" << n_past << " n_kv=" << n_kv << ": relative error " << rel);
+        for (int t = n_past; t < n_kv; t++) {
+            CHECK(scores[t] == 0.0f, "masked key " << t << " has weight " << scores[t]);
+        }
+
+        // softmax * V itself only rounds in float: compare with the returned weights against the dequantized V
+        std::vector<float> vrow(n_ctx);
+        for (int c = 0; c < head_dim; c++) {
+            ggml_bitnet_kv_dequantize_row_i8(vt.data() + c * nb_ctx, vrow.data(), n_ctx);
+            double ref = 0.0, mag = 0.0;
+            for (int t = 0; t < n_past; t++) {
+                ref += (double)scores[t] * vrow[t];
+                mag += fabs((double)scores[t] * vrow[t]);
+            }
+            CHECK(fabs(out[c] - ref) <= 1e-5 * mag + 1e-7, "softmax * V of channel " << c << ": " << out[c] << " != " << ref);
+        }
+    }
+}
+
+int main() {
+    std::cout << "Int8 KV Cache Test" << std::endl;
+    std::cout << "==================" << std::endl;
+
+    test_layout();
+    test_round_trip();
+    test_vec_dot();
+    test_store_v();
+    test_attention();
+
+    if (failures == 0) {
+        std::cout << "\n✓ All tests passed" << std::endl;
+        return 0;
+    }
+    std::cout << "\n✗ " << failures << " checks failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,78 @@
+/**
+ * Test for the low-jitter decode helpers
+ *
+ * Checks that static partitions cover every row exactly once, with aligned
+ * and deterministic boundaries, and that the clock is monotonic.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+#include "ggml-bitnet-realtime.h"
+
+static int failures = 0;
+
+#define CHECK(cond, msg) \
+    do { \
+        if (!(cond)) { \
+            std::cout << "  ✗ " << msg << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+static void test_partition() {
+    std::cout << "Static partition..." << std::endl;
+    const int sizes[] = {1, 7, 128, 1000, 2560, 6912};
+    const int aligns[] = {1, 4, 16, 64};
+    for (int n : sizes) {
+        for (int align : aligns) {
+            for (int nth = 1; nth <= 12; nth++) {
+                std::vector<int> hits(n, 0);
+                int prev_end = 0;
+                for (int ith = 0; ith < nth; ith++) {
+                    int start, end;
+                    ggml_bitnet_rt_partition(ith, nth, n, align, &start, &end);
+                    CHECK(start == prev_end, "ranges are not contiguous (n=" << n << " nth=" << nth << ")");
+                    CHECK(start % align == 0 || start == n, "range start is not aligned");
+                    for (int i = start; i < end; i++) hits[i]++;
+                    prev_end = end;
+
+                    // the split must not depend on anything but its inputs
+                    int start2, end2;
+                    ggml_bitnet_rt_partition(ith, nth, n, align, &start2, &end2);
+                    CHECK(start == start2 && end == end2, "partition is not deterministic");
+                }
+                CHECK(prev_end == n, "ranges do not end at n");
+                for (int i = 0; i < n; i++) {
+                    CHECK(hits[i] == 1, "row " << i << " covered " << hits[i] << " times");
+                }
+            }
+        }
+    }
+}
+
+static void test_clock() {
+    std::cout << "Monotonic clock..." << std::endl;
+    uint64_t prev = ggml_bitnet_rt_now_ns();
+    for (int i = 0; i < 1000; i++) {
+        const uint64_t now = ggml_bitnet_rt_now_ns();
+        CHECK(now >= prev, "clock went backwards");
+        prev = now;
+    }
+}
+
+int main() {
+    std::cout << "Low-Jitter Decode Helpers Test" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    test_partition();
+    test_clock();
+
+    if (failures == 0) {
+        std::cout << "\n✓ All tests passed" << std::endl;
+        return 0;
+    }
+    std::cout << "\n✗ " << failures << " checks failed" << std::endl;
+    return 1;
+}
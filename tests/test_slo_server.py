@@ -0,0 +1,220 @@
+"""
+Unit tests for the SLO scheduler of utils/slo_server.py
+
+Covers the decode cost model, admission, prefill chunk sizing and the batch
+size the scheduler feeds back into the cost model, on a fake clock and with
+a fake llama-server backend, so no server or model is needed.
+
+Run: python3 tests/test_slo_server.py
+"""
+
+import os
+import sys
+import unittest
+from unittest import mock
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "utils"))
+
+import slo_server
+from slo_server import CHUNK_ALIGN, CostModel, SloScheduler, SloServer
+
+CLASSES = {
+    "interactive": {"rank": 0, "ttft_ms": 1000, "tpot_ms": 100},
+    "standard":    {"rank": 1, "ttft_ms": 5000, "tpot_ms": 250},
+    "batch":       {"rank": 2, "ttft_ms": 60000, "tpot_ms": 2000},
+}
+
+
+class FakeClock:
+    def __init__(self):
+        self.now = 100.0
+
+    def __call__(self):
+        return self.now
+
+
+class FakeBackend:
+    """Answers /completion like llama-server, at a fixed prefill cost per token."""
+
+    def __init__(self, prefill_ms_per_token):
+        self.prefill_ms_per_token = prefill_ms_per_token
+        self.posts = []
+
+    def post(self, path, payload):
+        self.posts.append((path, payload))
+        n = len(payload["prompt"]) - sum(len(p["prompt"]) for _, p in self.posts[:-1])
+        return {"timings": {"prompt_n": n, "prompt_ms": n * self.prefill_ms_per_token}}
+
+
+class SchedulerTest(unittest.TestCase):
+    def setUp(self):
+        self.clock = FakeClock()
+        patcher = mock.patch.object(slo_server.time, "perf_counter", self.clock)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def scheduler(self, n_slots=4, reserve=0, chunk_min=32):
+        return SloScheduler(CLASSES, n_slots, reserve, chunk_min)
+
+    def admit(self, sched, cls_name, n_prompt=0, decoding=True):
+        req = sched.submit(cls_name, n_prompt)
+        if decoding:
+            sched.start_decode(req)
+        return req
+
+
+class CostModelTest(unittest.TestCase):
+    def test_empty(self):
+        self.assertEqual(CostModel().step(4), 0.0)
+
+    def test_measured(self):
+        cost = CostModel()
+        cost.observe_decode(2, 40.0)
+        self.assertEqual(cost.step(2), 40.0)
+        # the EWMA moves a measured size toward new samples
+        cost.observe_decode(2.4, 50.0)
+        self.assertAlmostEqual(cost.step(2), 42.0)
+
+    def test_one_size_extrapolates_by_prefill_cost(self):
+        cost = CostModel()
+        cost.observe_prefill(100, 500.0)
+        cost.observe_decode(1, 30.0)
+        self.assertAlmostEqual(cost.step(3), 40.0)
+        self.assertEqual(cost.step(1), 30.0)
+
+    def test_least_squares(self):
+        cost = CostModel()
+        for n, ms in ((1, 30.0), (2, 34.0), (4, 42.0)):
+            cost.observe_decode(n, ms)
+        self.assertAlmostEqual(cost.step(8), 58.0)
+
+    def test_never_cheaper_with_more_sequences(self):
+        cost = CostModel()
+        cost.observe_decode(1, 40.0)
+        cost.observe_decode(3, 30.0)
+        self.assertAlmostEqual(cost.step(6), 35.0)
+
+
+class AdmissibleTest(SchedulerTest):
+    def test_empty_batch(self):
+        sched = self.scheduler()
+        req = slo_server.Request("batch", CLASSES["batch"], 0)
+        self.assertTrue(sched._admissible(req, self.clock.now))
+
+    def test_no_free_slot(self):
+        sched = self.scheduler(n_slots=1)
+        self.admit(sched, "batch")
+        req = slo_server.Request("interactive", CLASSES["interactive"], 0)
+        self.assertFalse(sched._admissible(req, req.deadline + 1))
+
+    def test_reserved_slots(self):
+        sched = self.scheduler(n_slots=2, reserve=1)
+        self.admit(sched, "standard")
+        low = slo_server.Request("standard", CLASSES["standard"], 0)
+        top = slo_server.Request("interactive", CLASSES["interactive"], 0)
+        self.assertFalse(sched._admissible(low, low.deadline + 1))
+        self.assertTrue(sched._admissible(top, self.clock.now))
+
+    def test_tightest_tpot(self):
+        sched = self.scheduler()
+        sched.cost.observe_decode(1, 60.0)
+        sched.cost.observe_decode(2, 120.0)
+        self.admit(sched, "interactive")
+        # a second sequence would take the interactive step to 120 ms, over its 100 ms
+        req = slo_server.Request("batch", CLASSES["batch"], 0)
+        self.assertFalse(sched._admissible(req, self.clock.now))
+        sched.cost.step_ms[2] = 90.0
+        self.assertTrue(sched._admissible(req, self.clock.now))
+
+    def test_new_request_target_counts(self):
+        sched = self.scheduler()
+        sched.cost.observe_decode(1, 60.0)
+        sched.cost.observe_decode(2, 120.0)
+        self.admit(sched, "batch")
+        req = slo_server.Request("interactive", CLASSES["interactive"], 0)
+        self.assertFalse(sched._admissible(req, self.clock.now))
+
+    def test_past_deadline(self):
+        sched = self.scheduler()
+        sched.cost.observe_decode(1, 60.0)
+        sched.cost.observe_decode(2, 120.0)
+        self.admit(sched, "interactive")
+        req = slo_server.Request("batch", CLASSES["batch"], 0)
+        self.assertTrue(sched._admissible(req, req.deadline))
+
+
+class PrefillChunkTest(SchedulerTest):
+    def test_unguarded(self):
+        sched = self.scheduler()
+        sched.cost.observe_prefill(100, 100.0)
+        sched.cost.observe_decode(1, 40.0)
+        # only less important sequences decode
+        self.admit(sched, "batch")
+        req = self.admit(sched, "interactive", 1000, decoding=False)
+        self.assertEqual(sched.prefill_chunk(req, 1000), 1000)
+
+    def test_no_prefill_cost(self):
+        sched = self.scheduler()
+        self.admit(sched, "interactive")
+        req = self.admit(sched, "standard", 1000, decoding=False)
+        self.assertEqual(sched.prefill_chunk(req, 1000), 1000)
+
+    def test_slack(self):
+        sched = self.scheduler(chunk_min=32)
+        sched.cost.observe_prefill(100, 50.0)
+        sched.cost.observe_decode(1, 40.0)
+        self.admit(sched, "interactive")
+        req = self.admit(sched, "standard", 1000, decoding=False)
+        # 100 ms target - 40 ms step = 60 ms of slack, 120 tokens at 0.5 ms, aligned down
+        self.assertEqual(sched.prefill_chunk(req, 1000), 120 // CHUNK_ALIGN * CHUNK_ALIGN)
+        self.assertEqual(sched.prefill_chunk(req, 50), 50)
+
+    def test_chunk_min(self):
+        sched = self.scheduler(chunk_min=64)
+        sched.cost.observe_prefill(100, 100.0)
+        sched.cost.observe_decode(1, 95.0)
+        self.admit(sched, "interactive")
+        req = self.admit(sched, "standard", 1000, decoding=False)
+        self.assertEqual(sched.prefill_chunk(req, 1000), 64)
+
+    def test_prefill_through_backend(self):
+        sched = self.scheduler(chunk_min=32)
+        sched.cost.observe_prefill(100, 50.0)
+        sched.cost.observe_decode(1, 40.0)
+        self.admit(sched, "interactive")
+        req = self.admit(sched, "standard", 300, decoding=False)
+        backend = FakeBackend(0.5)
+        SloServer(backend, sched).prefill(req, list(range(300)))
+        # 96-token chunks through the slot's prompt cache; the final request evaluates the rest
+        self.assertEqual([len(p["prompt"]) for _, p in backend.posts], [96, 192, 288])
+        self.assertTrue(all(p["id_slot"] == req.slot and p["n_predict"] == 0 for _, p in backend.posts))
+        self.assertAlmostEqual(sched.cost.prefill_ms_per_token, 0.5)
+
+
+class DecodeBatchTest(SchedulerTest):
+    def test_batch_over_the_slot_interval(self):
+        sched = self.scheduler()
+        other = self.admit(sched, "batch")
+        req = self.admit(sched, "standard")
+        # 1 s of final prompt evaluation and 1 s of decode, both in a batch of two
+        self.clock.now += 2.0
+        sched.finish(req, {"prompt_n": 100, "prompt_ms": 1000.0, "predicted_n": 10,
+                           "predicted_ms": 1000.0, "predicted_per_token_ms": 100.0}, 2000.0)
+        self.assertEqual(sched.cost.step_ms, {2: 100.0})
+        sched.finish(other, None, 0.0)
+
+    def test_batch_shrinks(self):
+        sched = self.scheduler()
+        other = self.admit(sched, "batch")
+        req = self.admit(sched, "standard")
+        self.clock.now += 1.0
+        sched.finish(other, None, 0.0)
+        self.clock.now += 3.0
+        sched.finish(req, {"prompt_n": 0, "predicted_n": 10, "predicted_ms": 3000.0,
+                           "predicted_per_token_ms": 50.0}, 4000.0)
+        # (2 * 1 s + 1 * 3 s) / 4 s rounds to one sequence
+        self.assertEqual(sched.cost.step_ms, {1: 50.0})
+
+
+if __name__ == "__main__":
+    unittest.main()
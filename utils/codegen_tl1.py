@@ -4,6 +4,7 @@ from configparser import ConfigParser
 
 def gen_ctor_code():
     kernel_code = "\n\
+#if !defined(BITNET_KERNELS_STANDALONE)\n\
 #include \"ggml-bitnet.h\"\n\
 #define GGML_BITNET_MAX_NODES 8192\n\
 static bool initialized = false;\n\
@@ -25,6 +26,7 @@ static void aligned_free(void * ptr) {{\n\
     free(ptr);\n\
 #endif\n\
 }}\n\
+#endif\n\
 \n\
 void per_tensor_quant(int k, void* lut_scales_, void* b_) {{\n\
     bitnet_float_type* lut_scales = (bitnet_float_type*)lut_scales_;\n\
@@ -176,6 +178,7 @@ inline void lut_ctor(int8_t* qlut, bitnet_float_type* b, bitnet_float_type* lut_
 #endif\n\
 }}\n\
 \n\
+#if !defined(BITNET_KERNELS_STANDALONE)\n\
 static bool is_type_supported(enum ggml_type type) {{\n\
     if (type == GGML_TYPE_Q4_0 ||\n\
         type == GGML_TYPE_TL1) {{\n\
@@ -184,6 +187,7 @@ static bool is_type_supported(enum ggml_type type) {{\n\
         return false;\n\
     }}\n\
 }}\n\
+#endif\n\
 "
     return kernel_code
 
@@ -294,6 +298,7 @@ def gen_top_api(kernel_shapes):
         preprocessor_k<{1}>(B, LUT_Scales, QLUT);\n\
     }}\n".format(kernel_shapes[i][0], kernel_shapes[i][1])])
     kernel_code = "".join([kernel_code, "}\n"])
+    kernel_code = "".join([kernel_code, gen_preprocessor_mt_code()])
     kernel_code = "".join([kernel_code, "void ggml_qgemm_lut(int m, int k, void* A, void* LUT, void* Scales, void* LUT_Scales, void* C) {{\n\
     if (m == {0} && k == {1}) {{\n\
         qgemm_lut_{0}_{1}(A, LUT, Scales, LUT_Scales, C);\n\
@@ -307,6 +312,28 @@ def gen_top_api(kernel_shapes):
     kernel_code = "".join([kernel_code, "}\n"])
     return kernel_code
 
+def gen_preprocessor_mt_code():
+    # Thread-partitioned ggml_preprocessor in two steps with a barrier between them: ggml_preprocessor_scales_mt
+    # computes each column absmax once, then ggml_preprocessor_mt builds the LUTs of one column from its shared
+    # scale. TL1 only sees a single activation column per call, so threads split its K dimension into runs of
+    # 16-act LUT blocks.
+    kernel_code = "void ggml_preprocessor_scales_mt(int ith, int nth, int bs, int k, void* B, void* LUT_Scales) {\n\
+    const int32_t b_start = (int32_t)((int64_t)bs * ith / nth);\n\
+    const int32_t b_end = (int32_t)((int64_t)bs * (ith + 1) / nth);\n\
+    for (int32_t b = b_start; b < b_end; b++) {\n\
+        per_tensor_quant(k, (&(((bitnet_float_type*)LUT_Scales)[b])), (&(((bitnet_float_type*)B)[b * k])));\n\
+    }\n\
+}\n\
+void ggml_preprocessor_mt(int ith, int nth, int k, void* B, void* LUT_Scales, void* QLUT) {\n\
+    const int32_t n_blocks = k / 16;\n\
+    const int32_t blk_start = (int32_t)((int64_t)n_blocks * ith / nth);\n\
+    const int32_t blk_end = (int32_t)((int64_t)n_blocks * (ith + 1) / nth);\n\
+    for (int32_t blk = blk_start; blk < blk_end; blk++) {\n\
+        lut_ctor<16>((&(((int8_t*)QLUT)[blk * 256])), (&(((bitnet_float_type*)B)[blk * 16])), (bitnet_float_type*)LUT_Scales);\n\
+    }\n\
+}\n"
+    return kernel_code
+
 def gen_preprocess_code():
     kernel_code = "\n\
 template<int K>\n\
@@ -425,7 +452,9 @@ if __name__ == "__main__":
             f.write(''.join(code))
         f.write(''.join(pre_code))
         f.write(''.join(api_code))
+        f.write(''.join("\n#if !defined(BITNET_KERNELS_STANDALONE)"))
         f.write(''.join(trans_code))
+        f.write(''.join("#endif\n"))
         f.write(''.join("#endif"))
 
     config = ConfigParser()
@@ -4,9 +4,10 @@ from configparser import ConfigParser
 
 def gen_ctor_code():
     kernel_code = "\n\
-#include \"ggml-bitnet.h\"\n\
 #include <cstring>\n\
 #include <immintrin.h>\n\
+#if !defined(BITNET_KERNELS_STANDALONE)\n\
+#include \"ggml-bitnet.h\"\n\
 #define GGML_BITNET_MAX_NODES 8192\n\
 static bool initialized = false;\n\
 static bitnet_tensor_extra * bitnet_tensor_extras = nullptr;\n\
@@ -28,6 +29,7 @@ static void aligned_free(void * ptr) {\n\
     free(ptr);\n\
 #endif\n\
 }\n\
+#endif\n\
 #define BK2 32\n\
 #if defined __AVX2__\n\
 inline void _mm256_merge_epi32(const __m256i v0, const __m256i v1, __m256i *vl, __m256i *vh)\n\
@@ -265,6 +267,7 @@ inline int32_t two_lut_ctor(int8_t* qlut, bitnet_float_type* b, bitnet_float_typ
 #endif\n\
     return 0;\n\
 }\n\
+#if !defined(BITNET_KERNELS_STANDALONE)\n\
 static bool is_type_supported(enum ggml_type type) {\n\
     if (type == GGML_TYPE_Q4_0 ||\n\
         type == GGML_TYPE_TL2) {\n\
@@ -273,6 +276,7 @@ static bool is_type_supported(enum ggml_type type) {\n\
         return false;\n\
     }\n\
 }\n\
+#endif\n\
 "
     return kernel_code
 
@@ -529,6 +533,43 @@ int32_t two_qgemm_lut_{0}(void* A, void* LUT, void* Scales, void* LUT_Scales, vo
 ".format(pre, k_list[1], k_list[0])])
     return kernel_code
 
+def gen_preprocessor_mt_code():
+    # Thread-partitioned ggml_preprocessor in two steps with a barrier between them: ggml_preprocessor_scales_mt
+    # computes each column absmax once, then ggml_preprocessor_mt builds the LUTs from the shared scales. LUT work
+    # units are (column, K-chunk) pairs, columns are only split into K-chunks when bs < nth. LUT blocks are built
+    # one at a time (24 acts for three_lut_ctor, 16 acts for two_lut_ctor) so the code does not depend on the
+    # kernel shapes.
+    kernel_code = "void ggml_preprocessor_scales_mt(int ith, int nth, int bs, int three_k, int two_k, void* B, void* LUT_Scales) {\n\
+    const int32_t b_start = (int32_t)((int64_t)bs * ith / nth);\n\
+    const int32_t b_end = (int32_t)((int64_t)bs * (ith + 1) / nth);\n\
+    for (int32_t b = b_start; b < b_end; b++) {\n\
+        per_tensor_quant(two_k + three_k, (&(((bitnet_float_type*)LUT_Scales)[b])), (&(((bitnet_float_type*)B)[b * (three_k + two_k)])));\n\
+    }\n\
+}\n\
+void ggml_preprocessor_mt(int ith, int nth, int bs, int three_k, int two_k, void* B, void* LUT_Scales, void* Three_QLUT, void* Two_QLUT) {\n\
+    const int32_t three_blocks = three_k / 24;\n\
+    const int32_t n_blocks = three_blocks + two_k / 16;\n\
+    const int32_t n_chunks = bs >= nth ? 1 : (nth + bs - 1) / bs;\n\
+    const int32_t n_units = bs * n_chunks;\n\
+    const int32_t unit_start = (int32_t)((int64_t)n_units * ith / nth);\n\
+    const int32_t unit_end = (int32_t)((int64_t)n_units * (ith + 1) / nth);\n\
+    for (int32_t u = unit_start; u < unit_end; u++) {\n\
+        const int32_t b = u / n_chunks;\n\
+        const int32_t c = u % n_chunks;\n\
+        const int32_t blk_start = n_blocks * c / n_chunks;\n\
+        const int32_t blk_end = n_blocks * (c + 1) / n_chunks;\n\
+        bitnet_float_type* b_col = (&(((bitnet_float_type*)B)[b * (three_k + two_k)]));\n\
+        bitnet_float_type* lut_scales = (&(((bitnet_float_type*)LUT_Scales)[b]));\n\
+        for (int32_t blk = blk_start; blk < blk_end && blk < three_blocks; blk++) {\n\
+            three_lut_ctor<24>((&(((int8_t*)Three_QLUT)[b * three_k / 3 * 32 + blk * 256])), b_col + blk * 24, lut_scales);\n\
+        }\n\
+        for (int32_t blk = blk_start > three_blocks ? blk_start : three_blocks; blk < blk_end; blk++) {\n\
+            two_lut_ctor<16>((&(((int8_t*)Two_QLUT)[b * two_k / 2 * 32 + (blk - three_blocks) * 256])), b_col + three_k + (blk - three_blocks) * 16, lut_scales);\n\
+        }\n\
+    }\n\
+}\n"
+    return kernel_code
+
 def gen_top_api(kernel_shapes, k_list):
 
     kernel_code = "void ggml_preprocessor(int bs, int m, int three_k, int two_k, void* B, void* LUT_Scales, void* Three_QLUT, void* Two_QLUT) {{\n\
@@ -550,6 +591,7 @@ def gen_top_api(kernel_shapes, k_list):
         }}\n\
     }}\n".format(kernel_shapes[i][0], k_list[i][0], k_list[i][1])])
     kernel_code = "".join([kernel_code, "}\n"])
+    kernel_code = "".join([kernel_code, gen_preprocessor_mt_code()])
 
 
     kernel_code = "".join([kernel_code, "void ggml_qgemm_lut(int bs, int m, int k, int BK, void* A, void* sign, void* LUT, void* Scales, void* LUT_Scales, void* C) {{\n\
@@ -740,7 +782,9 @@ if __name__ == "__main__":
         for code in tbl_impl_code:
             f.write(''.join(code))
         f.write(''.join(api_code))
+        f.write(''.join("\n#if !defined(BITNET_KERNELS_STANDALONE)"))
         f.write(''.join(trans_code))
+        f.write(''.join("#endif\n"))
         f.write(''.join("#endif"))
 
     config = ConfigParser()
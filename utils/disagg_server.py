@@ -0,0 +1,305 @@
+"""
+Prefill/decode disaggregation for llama-server.
+
+Two llama-server instances run on disjoint core sets:
+  - the prefill pool evaluates prompts with large batches (GEMM / batched TL2 path),
+  - the decode pool only generates tokens (GEMV path, batch of in-flight slots).
+
+When a prompt has been evaluated, its slot state is saved to a shared memory
+directory (/dev/shm by default) and restored into a free decode slot. The
+decode pool never runs a long prefill, so prompt bursts do not stall the
+per-token latency of the sequences it is already generating.
+"""
+
+import os
+import sys
+import json
+import time
+import uuid
+import queue
+import shutil
+import logging
+import threading
+import subprocess
+import http.client
+import urllib.error
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+logger = logging.getLogger("disagg_server")
+
+DECODE_BATCH_SIZE = 512
+
+
+def parse_cores(spec):
+    """Parse a core list like '0-3,8,10-11' into a list of core ids."""
+    cores = []
+    for part in spec.split(','):
+        part = part.strip()
+        if not part:
+            continue
+        if '-' in part:
+            lo, hi = part.split('-')
+            cores.extend(range(int(lo), int(hi) + 1))
+        else:
+            cores.append(int(part))
+    return cores
+
+
+class ServerPool:
+    """One llama-server process pinned to a core set, with a queue of free slots."""
+
+    def __init__(self, name, server_path, model, cores, threads, n_slots, ctx_size,
+                 batch_size, ubatch_size, port, slot_dir, extra_args=None):
+        self.name = name
+        self.cores = cores
+        self.n_slots = n_slots
+        self.port = port
+        self.url = f"http://127.0.0.1:{port}"
+        self.command = [
+            server_path,
+            '-m', model,
+            # llama-server splits the context across slots, keep ctx_size per slot
+            '-c', str(ctx_size * n_slots),
+            '-np', str(n_slots),
+            '-t', str(threads),
+            '-b', str(batch_size),
+            '-ub', str(ubatch_size),
+            '-ngl', '0',
+            '--host', '127.0.0.1',
+            '--port', str(port),
+            '-cb',
+        ]
+        if slot_dir:
+            self.command.extend(['--slot-save-path', slot_dir])
+        if extra_args:
+            self.command.extend(extra_args)
+        self.free_slots = queue.Queue()
+        for slot in range(n_slots):
+            self.free_slots.put(slot)
+        self.process = None
+
+    def start(self, log_path=None, new_session=False):
+        def pin():
+            if self.cores and hasattr(os, "sched_setaffinity"):
+                os.sched_setaffinity(0, self.cores)
+        logger.info(f"Starting {self.name} pool on cores {self.cores}: {' '.join(self.command)}")
+        # a server started for an interactive client logs to a file instead of the client's terminal
+        log = open(log_path, "wb") if log_path else None
+        try:
+            # new_session keeps the terminal's Ctrl+C from the server, so its owner can still save slots
+            self.process = subprocess.Popen(self.command, preexec_fn=pin if os.name == "posix" else None,
+                                            stdout=log, stderr=subprocess.STDOUT if log else None,
+                                            start_new_session=new_session)
+        finally:
+            if log:
+                log.close()
+
+    def wait_ready(self, timeout=600):
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            if self.process.poll() is not None:
+                raise RuntimeError(f"{self.name} server exited with code {self.process.returncode}")
+            try:
+                with urllib.request.urlopen(self.url + "/health", timeout=5) as resp:
+                    if resp.status == 200:
+                        return
+            except (urllib.error.URLError, ConnectionError):
+                pass
+            time.sleep(0.5)
+        raise RuntimeError(f"{self.name} server did not become ready in {timeout}s")
+
+    def stop(self):
+        if self.process and self.process.poll() is None:
+            self.process.terminate()
+            self.process.wait()
+
+    def acquire_slot(self):
+        return self.free_slots.get()
+
+    def release_slot(self, slot):
+        self.free_slots.put(slot)
+
+    def request(self, path, payload=None):
+        data = json.dumps(payload).encode() if payload is not None else None
+        req = urllib.request.Request(self.url + path, data=data, headers={"Content-Type": "application/json"})
+        return urllib.request.urlopen(req)
+
+    def post(self, path, payload):
+        with self.request(path, payload) as resp:
+            return json.loads(resp.read() or b"{}")
+
+
+class DisaggregatedServer:
+    """Routes /completion through the prefill pool, then hands the slot state to the decode pool."""
+
+    def __init__(self, prefill, decode, slot_dir):
+        self.prefill = prefill
+        self.decode = decode
+        self.slot_dir = slot_dir
+        self.lock = threading.Lock()
+        # queue times are waits for a free slot, kept apart from the work they precede
+        self.stats = {"requests": 0, "prefill_queue_ms": 0.0, "prefill_ms": 0.0, "decode_queue_ms": 0.0,
+                      "handoff_ms": 0.0, "handoff_bytes": 0}
+
+    def prefill_and_handoff(self, prompt):
+        """Evaluate the prompt on the prefill pool and restore it into a decode slot. Returns the decode slot."""
+        filename = f"bitnet-{uuid.uuid4().hex}.bin"
+        path = os.path.join(self.slot_dir, filename)
+
+        t0 = time.perf_counter()
+        p_slot = self.prefill.acquire_slot()
+        try:
+            t1 = time.perf_counter()
+            self.prefill.post("/completion", {"prompt": prompt, "n_predict": 0, "cache_prompt": True, "id_slot": p_slot})
+            t2 = time.perf_counter()
+            self.prefill.post(f"/slots/{p_slot}?action=save", {"filename": filename})
+            t3 = time.perf_counter()
+        except Exception:
+            if os.path.exists(path):
+                os.remove(path)
+            raise
+        finally:
+            self.prefill.release_slot(p_slot)
+
+        d_slot = self.decode.acquire_slot()
+        try:
+            t4 = time.perf_counter()
+            self.decode.post(f"/slots/{d_slot}?action=restore", {"filename": filename})
+            t5 = time.perf_counter()
+        except Exception:
+            self.decode.release_slot(d_slot)
+            raise
+        finally:
+            size = os.path.getsize(path) if os.path.exists(path) else 0
+            if os.path.exists(path):
+                os.remove(path)
+
+        with self.lock:
+            self.stats["requests"] += 1
+            self.stats["prefill_queue_ms"] += (t1 - t0) * 1000
+            self.stats["prefill_ms"] += (t2 - t1) * 1000
+            self.stats["decode_queue_ms"] += (t4 - t3) * 1000
+            self.stats["handoff_ms"] += (t3 - t2 + t5 - t4) * 1000
+            self.stats["handoff_bytes"] += size
+        return d_slot
+
+    def make_handler(self):
+        server = self
+
+        class Handler(BaseHTTPRequestHandler):
+            protocol_version = "HTTP/1.1"
+
+            def log_message(self, fmt, *args):
+                logger.debug(fmt % args)
+
+            def reply_raw(self, status, content_type, body):
+                self.send_response(status)
+                self.send_header("Content-Type", content_type)
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def reply_json(self, status, obj):
+                self.reply_raw(status, "application/json", json.dumps(obj).encode())
+
+            def do_GET(self):
+                if self.path == "/health":
+                    self.reply_json(200, {"status": "ok"})
+                elif self.path == "/stats":
+                    with server.lock:
+                        self.reply_json(200, dict(server.stats))
+                else:
+                    self.reply_json(404, {"error": "not found"})
+
+            def do_POST(self):
+                if self.path not in ("/completion", "/completions"):
+                    self.reply_json(404, {"error": "only /completion is routed in disaggregated mode"})
+                    return
+                payload = json.loads(self.rfile.read(int(self.headers.get("Content-Length", 0))) or b"{}")
+                prompt = payload.get("prompt", "")
+                try:
+                    d_slot = server.prefill_and_handoff(prompt)
+                except Exception as e:
+                    self.reply_json(502, {"error": f"prefill handoff failed: {e}"})
+                    return
+                started = False
+                try:
+                    # the restored slot already holds the prompt, cache_prompt makes the decode pool reuse it
+                    payload.update({"cache_prompt": True, "id_slot": d_slot})
+                    with server.decode.request("/completion", payload) as resp:
+                        self.send_response(resp.status)
+                        self.send_header("Content-Type", resp.headers.get("Content-Type", "application/json"))
+                        self.send_header("Transfer-Encoding", "chunked")
+                        self.end_headers()
+                        started = True
+                        while True:
+                            chunk = resp.read1(65536) if hasattr(resp, "read1") else resp.read(65536)
+                            if not chunk:
+                                break
+                            self.wfile.write(b"%x\r\n%s\r\n" % (len(chunk), chunk))
+                            self.wfile.flush()
+                        self.wfile.write(b"0\r\n\r\n")
+                except urllib.error.HTTPError as e:
+                    # the decode server refused the request: pass its status and body on
+                    self.reply_raw(e.code, e.headers.get("Content-Type", "application/json"), e.read())
+                except (urllib.error.URLError, http.client.HTTPException, OSError) as e:
+                    if started:
+                        # a second response cannot follow a started stream, end it without the last chunk
+                        self.close_connection = True
+                    else:
+                        self.reply_json(502, {"error": f"decode failed: {e}"})
+                finally:
+                    server.decode.release_slot(d_slot)
+
+        return Handler
+
+    def serve(self, host, port):
+        httpd = ThreadingHTTPServer((host, port), self.make_handler())
+        logger.info(f"Disaggregated server listening on {host}:{port}")
+        try:
+            httpd.serve_forever()
+        finally:
+            httpd.server_close()
+
+
+def run_disaggregated(args, server_path):
+    """Entry point used by run_inference_server.py --disaggregate."""
+    logging.basicConfig(level=logging.INFO)
+
+    prefill_cores = parse_cores(args.prefill_cores)
+    decode_cores = parse_cores(args.decode_cores)
+    if set(prefill_cores) & set(decode_cores):
+        logger.error("--prefill-cores and --decode-cores must not overlap")
+        sys.exit(1)
+    if hasattr(os, "sched_getaffinity"):
+        missing = set(prefill_cores + decode_cores) - os.sched_getaffinity(0)
+        if missing:
+            logger.error(f"Cores {sorted(missing)} are not available to this process")
+            sys.exit(1)
+
+    os.makedirs(args.slot_dir, exist_ok=True)
+
+    prefill = ServerPool(
+        "prefill", server_path, args.prefill_model or args.model, prefill_cores,
+        args.prefill_threads or len(prefill_cores), args.prefill_slots, args.ctx_size,
+        args.prefill_batch_size, args.prefill_batch_size, args.port + 1, args.slot_dir)
+    decode = ServerPool(
+        "decode", server_path, args.model, decode_cores,
+        args.decode_threads or len(decode_cores), args.decode_slots, args.ctx_size,
+        # decode batches are small, but a prompt suffix the restored slot misses is still evaluated in one batch
+        DECODE_BATCH_SIZE, DECODE_BATCH_SIZE, args.port + 2, args.slot_dir,
+        ['-n', str(args.n_predict), '--temp', str(args.temperature)])
+
+    pools = [prefill, decode]
+    try:
+        for pool in pools:
+            pool.start()
+        for pool in pools:
+            pool.wait_ready()
+        DisaggregatedServer(prefill, decode, args.slot_dir).serve(args.host, args.port)
+    finally:
+        for pool in pools:
+            pool.stop()
+        if args.slot_dir.startswith("/dev/shm/"):
+            shutil.rmtree(args.slot_dir, ignore_errors=True)
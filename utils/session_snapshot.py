@@ -0,0 +1,297 @@
+"""
+Session snapshots for llama-cli prompt caches and llama-server slot files.
+
+A snapshot wraps the llama.cpp state file (KV cache plus token ids) in a
+chunked container:
+
+    header   magic "BNSS", version, codec, chunk size, raw size, chunk count
+    meta     JSON: model identity, state kind, prompt text or chat messages, token count
+    table    (offset, compressed size) per chunk
+    chunks   raw or zlib-compressed slices of the state file
+
+Chunks are independent, so restore decompresses them on a thread pool
+straight into an mmap of the output file (zlib releases the GIL). With
+codec "none" every chunk can be mmapped in place. The metadata lets a
+resumed conversation check that the model matches and that the new prompt
+extends the stored one before any state is loaded.
+
+save_slot() and restore_slot() move snapshots in and out of a running
+llama-server through its /slots endpoints. A restore also checks at token
+level that the next prompt reuses the cached tokens.
+"""
+
+import os
+import sys
+import json
+import mmap
+import zlib
+import uuid
+import struct
+import argparse
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+SNAPSHOT_MAGIC = b"BNSS"
+SNAPSHOT_VERSION = 1
+HEADER = struct.Struct("<4sIIQQI")    # magic, version, codec, chunk_size, raw_size, n_chunks
+CHUNK_ENTRY = struct.Struct("<QQ")     # offset, stored size
+CODECS = {"none": 0, "zlib": 1}
+DEFAULT_CHUNK_SIZE = 8 << 20
+
+# llama.cpp state file magics (llama.h)
+LLAMA_SESSION_MAGIC = 0x6767736e       # 'ggsn', llama-cli --prompt-cache
+LLAMA_STATE_SEQ_MAGIC = 0x67677371     # 'ggsq', llama-server slot save
+
+
+def read_state_tokens(path):
+    """Return the token ids stored at the head of a llama.cpp state file."""
+    with open(path, "rb") as f:
+        # both formats start with magic, version, token count, tokens
+        magic, _version, n_tokens = struct.unpack("<III", f.read(12))
+        if magic not in (LLAMA_SESSION_MAGIC, LLAMA_STATE_SEQ_MAGIC):
+            raise ValueError(f"{path} is not a llama.cpp state file")
+        return list(struct.unpack(f"<{n_tokens}i", f.read(4 * n_tokens)))
+
+
+def model_identity(model_path):
+    """Cheap identity for a model file: name and size. A snapshot is only valid for the model that wrote it."""
+    st = os.stat(model_path)
+    return {"model": os.path.basename(model_path), "model_size": st.st_size}
+
+
+def pack(state_path, snapshot_path, meta, codec="zlib", level=1, chunk_size=DEFAULT_CHUNK_SIZE, threads=None):
+    """Write state_path into a snapshot container. Chunks are compressed in parallel."""
+    raw_size = os.path.getsize(state_path)
+    n_chunks = max(1, (raw_size + chunk_size - 1) // chunk_size)
+    meta = dict(meta)
+    meta["n_tokens"] = len(read_state_tokens(state_path))
+    meta_bytes = json.dumps(meta).encode()
+
+    with open(state_path, "rb") as f:
+        src = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) if raw_size else b""
+
+        def encode(i):
+            piece = src[i * chunk_size:(i + 1) * chunk_size]
+            return zlib.compress(piece, level) if codec == "zlib" else piece
+
+        with ThreadPoolExecutor(threads or os.cpu_count()) as pool:
+            chunks = list(pool.map(encode, range(n_chunks)))
+        if raw_size:
+            src.close()
+
+    offset = HEADER.size + 4 + len(meta_bytes) + CHUNK_ENTRY.size * n_chunks
+    table = []
+    for chunk in chunks:
+        table.append(CHUNK_ENTRY.pack(offset, len(chunk)))
+        offset += len(chunk)
+
+    tmp_path = snapshot_path + ".tmp"
+    with open(tmp_path, "wb") as out:
+        out.write(HEADER.pack(SNAPSHOT_MAGIC, SNAPSHOT_VERSION, CODECS[codec], chunk_size, raw_size, n_chunks))
+        out.write(struct.pack("<I", len(meta_bytes)))
+        out.write(meta_bytes)
+        out.writelines(table)
+        out.writelines(chunks)
+    # a crash mid-write must not leave a truncated snapshot behind
+    os.replace(tmp_path, snapshot_path)
+    return offset
+
+
+def read_meta(snapshot_path):
+    """Read the header and metadata of a snapshot without touching the chunks."""
+    with open(snapshot_path, "rb") as f:
+        magic, version, codec, chunk_size, raw_size, n_chunks = HEADER.unpack(f.read(HEADER.size))
+        if magic != SNAPSHOT_MAGIC or version != SNAPSHOT_VERSION:
+            raise ValueError(f"{snapshot_path} is not a version {SNAPSHOT_VERSION} session snapshot")
+        meta_len, = struct.unpack("<I", f.read(4))
+        meta = json.loads(f.read(meta_len))
+        table = [CHUNK_ENTRY.unpack(f.read(CHUNK_ENTRY.size)) for _ in range(n_chunks)]
+    header = {"codec": codec, "chunk_size": chunk_size, "raw_size": raw_size, "table": table}
+    return header, meta
+
+
+def unpack(snapshot_path, state_path, threads=None):
+    """Restore a snapshot to a llama.cpp state file, decompressing chunks in parallel into an mmap."""
+    header, meta = read_meta(snapshot_path)
+    raw_size = header["raw_size"]
+    chunk_size = header["chunk_size"]
+
+    with open(state_path, "wb+") as out:
+        out.truncate(raw_size)
+        if raw_size == 0:
+            return meta
+        dst = mmap.mmap(out.fileno(), raw_size)
+        with open(snapshot_path, "rb") as f:
+            src = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+            def decode(item):
+                i, (offset, size) = item
+                piece = src[offset:offset + size]
+                if header["codec"] == CODECS["zlib"]:
+                    piece = zlib.decompress(piece)
+                dst[i * chunk_size:i * chunk_size + len(piece)] = piece
+
+            with ThreadPoolExecutor(threads or os.cpu_count()) as pool:
+                list(pool.map(decode, enumerate(header["table"])))
+            src.close()
+        dst.flush()
+        dst.close()
+    return meta
+
+
+def check_resume(meta, model_path, prompt=None, messages=None, kind=None):
+    """
+    Decide whether a snapshot can be resumed for this model and prompt or conversation.
+
+    Returns (ok, reason). The prompt must extend the stored prompt: llama.cpp
+    then reuses every cached token and only evaluates the new suffix. Chat
+    messages must agree with the stored conversation as far as both go; the
+    longer one is the history to continue. kind, when given, is the state
+    file the caller can load: "prompt-cache" (llama-cli) or "slot" (llama-server).
+    """
+    ident = model_identity(model_path)
+    if meta.get("model") != ident["model"] or meta.get("model_size") != ident["model_size"]:
+        return False, f"snapshot was written by {meta.get('model')}, not {ident['model']}"
+    stored_kind = meta.get("kind", "prompt-cache")
+    if kind is not None and stored_kind != kind:
+        return False, f"snapshot holds a {stored_kind} state, this run loads a {kind} state"
+    if messages is not None:
+        stored = meta.get("messages", [])
+        for i, (a, b) in enumerate(zip(stored, messages)):
+            if a != b:
+                return False, f"conversation diverges from the snapshot at message {i + 1} of {len(stored)}"
+        return True, f"resuming {len(stored)} messages, {meta.get('n_tokens', 0)} cached tokens"
+    stored = meta.get("prompt", "")
+    if prompt is not None and not prompt.startswith(stored):
+        common = os.path.commonprefix([stored, prompt])
+        return False, f"prompt diverges from the snapshot after {len(common)} of {len(stored)} characters"
+    return True, f"resuming {meta.get('n_tokens', 0)} cached tokens"
+
+
+def sibling_path(snapshot_path):
+    """First free name next to a snapshot that must not be overwritten: name.1.ext, name.2.ext, ..."""
+    root, ext = os.path.splitext(snapshot_path)
+    i = 1
+    while os.path.exists(f"{root}.{i}{ext}"):
+        i += 1
+    return f"{root}.{i}{ext}"
+
+
+def _post(url, path, payload):
+    req = urllib.request.Request(url + path, data=json.dumps(payload).encode(),
+                                 headers={"Content-Type": "application/json"})
+    with urllib.request.urlopen(req) as resp:
+        return json.loads(resp.read() or b"{}")
+
+
+def save_slot(url, slot, slot_dir, snapshot_path, meta, codec="zlib"):
+    """Save a llama-server slot (slot_dir is the server's --slot-save-path) into a snapshot."""
+    filename = f"bitnet-session-{uuid.uuid4().hex}.bin"
+    path = os.path.join(slot_dir, filename)
+    try:
+        _post(url, f"/slots/{slot}?action=save", {"filename": filename})
+        return pack(path, snapshot_path, dict(meta, kind="slot"), codec)
+    finally:
+        if os.path.exists(path):
+            os.remove(path)
+
+
+def restore_slot(url, slot, slot_dir, snapshot_path, prompt=None):
+    """
+    Restore a snapshot into a llama-server slot.
+
+    With a prompt, the prompt is tokenized by the server first and must start
+    with at least one cached token; otherwise nothing is restored. Returns
+    (ok, reason, cached tokens, cached tokens the prompt reuses).
+    """
+    filename = f"bitnet-session-{uuid.uuid4().hex}.bin"
+    path = os.path.join(slot_dir, filename)
+    try:
+        unpack(snapshot_path, path)
+        cached = read_state_tokens(path)
+        reused = len(cached)
+        if prompt is not None:
+            tokens = _post(url, "/tokenize", {"content": prompt, "add_special": True})["tokens"]
+            reused = 0
+            while reused < min(len(cached), len(tokens)) and cached[reused] == tokens[reused]:
+                reused += 1
+            if cached and reused == 0:
+                return False, "the prompt shares no tokens with the snapshot", len(cached), 0
+        _post(url, f"/slots/{slot}?action=restore", {"filename": filename})
+        return True, f"restored {len(cached)} cached tokens, the prompt reuses {reused}", len(cached), reused
+    finally:
+        if os.path.exists(path):
+            os.remove(path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack, restore or inspect session snapshots")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("pack", help="Wrap a llama.cpp state file (prompt cache or saved slot)")
+    p.add_argument("state", help="State file written by --prompt-cache or /slots?action=save")
+    p.add_argument("snapshot", help="Output snapshot file")
+    p.add_argument("-m", "--model", required=True, help="Model the state belongs to")
+    p.add_argument("--prompt", default="", help="Prompt text the state was built from")
+    p.add_argument("--codec", choices=CODECS.keys(), default="zlib")
+    p.add_argument("--level", type=int, default=1, help="zlib level")
+    p.add_argument("-t", "--threads", type=int, default=None)
+
+    u = sub.add_parser("unpack", help="Restore a snapshot to a llama.cpp state file")
+    u.add_argument("snapshot")
+    u.add_argument("state")
+    u.add_argument("-t", "--threads", type=int, default=None)
+
+    i = sub.add_parser("info", help="Print snapshot metadata")
+    i.add_argument("snapshot")
+
+    sv = sub.add_parser("save-slot", help="Snapshot a slot of a running llama-server")
+    sr = sub.add_parser("restore-slot", help="Check a snapshot and restore it into a slot of a running llama-server")
+    for sp in (sv, sr):
+        sp.add_argument("snapshot")
+        sp.add_argument("--url", default="http://127.0.0.1:8080", help="llama-server address")
+        sp.add_argument("--slot", type=int, default=0)
+        sp.add_argument("--slot-dir", required=True, help="The server's --slot-save-path")
+        sp.add_argument("-m", "--model", required=True, help="Model the server runs")
+    sv.add_argument("--prompt", default="", help="Prompt text the slot was built from")
+    sv.add_argument("--codec", choices=CODECS.keys(), default="zlib")
+    sr.add_argument("--prompt", default=None, help="Next prompt for the slot; it must extend the stored prompt")
+
+    args = parser.parse_args()
+    if args.cmd == "pack":
+        meta = model_identity(args.model)
+        meta["prompt"] = args.prompt
+        size = pack(args.state, args.snapshot, meta, args.codec, args.level, threads=args.threads)
+        print(f"{args.state}: {os.path.getsize(args.state)} -> {size} bytes")
+    elif args.cmd == "unpack":
+        meta = unpack(args.snapshot, args.state, args.threads)
+        print(f"restored {meta.get('n_tokens', 0)} tokens to {args.state}")
+    elif args.cmd == "save-slot":
+        target = args.snapshot
+        if os.path.exists(target):
+            _, old = read_meta(target)
+            ok, reason = check_resume(old, args.model, args.prompt, kind="slot")
+            if not ok:
+                # never replace a snapshot of another model or conversation
+                target = sibling_path(target)
+                print(f"{args.snapshot}: {reason}, writing {target} instead")
+        meta = model_identity(args.model)
+        meta["prompt"] = args.prompt
+        size = save_slot(args.url, args.slot, args.slot_dir, target, meta, args.codec)
+        print(f"slot {args.slot}: saved {size} bytes to {target}")
+    elif args.cmd == "restore-slot":
+        _, meta = read_meta(args.snapshot)
+        ok, reason = check_resume(meta, args.model, args.prompt, kind="slot")
+        if ok:
+            ok, reason, _, _ = restore_slot(args.url, args.slot, args.slot_dir, args.snapshot, args.prompt)
+        print(f"{args.snapshot}: {reason}")
+        return 0 if ok else 1
+    else:
+        header, meta = read_meta(args.snapshot)
+        codec = [k for k, v in CODECS.items() if v == header["codec"]][0]
+        print(json.dumps({"codec": codec, "raw_size": header["raw_size"],
+                          "chunks": len(header["table"]), **meta}, indent=2))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,494 @@
+"""
+SLO-aware request scheduling for llama-server.
+
+A router in front of one llama-server gives every request a priority class
+with a time-to-first-token (TTFT) and a time-per-output-token (TPOT) target.
+Classes are picked with the "priority" field of the request body or the
+X-Priority header. Mixed traffic then shares one deployment:
+  - admission: a request takes a decode slot only if the projected decode
+    step with one more sequence still meets the tightest TPOT target of the
+    sequences already decoding; the queue is served by class, then by TTFT
+    deadline, and a request past its TTFT deadline is admitted regardless;
+  - prefill chunks: llama-server evaluates a prompt in the same batch as
+    the decode tokens of the other slots, so a long prompt stalls them. The
+    prompt is fed in chunks through the prompt cache, each sized to fit the
+    TPOT slack of the more important sequences that are decoding.
+
+Both decisions use a cost model of the running kernel configuration: the
+prefill cost per token and the decode step time versus batch size. It is
+seeded by a probe request at startup and updated from the timings of every
+response. GET /stats reports it with TTFT/TPOT percentiles and SLO
+attainment per class.
+"""
+
+import os
+import json
+import time
+import logging
+import threading
+import collections
+import http.client
+import urllib.error
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+from disagg_server import ServerPool
+
+logger = logging.getLogger("slo_server")
+
+# rank 0 is served first; targets in milliseconds
+DEFAULT_CLASSES = {
+    "interactive": {"rank": 0, "ttft_ms": 1000, "tpot_ms": 100},
+    "standard":    {"rank": 1, "ttft_ms": 5000, "tpot_ms": 250},
+    "batch":       {"rank": 2, "ttft_ms": 60000, "tpot_ms": 2000},
+}
+DEFAULT_CLASS = "standard"
+
+# prefill chunks are multiples of this many tokens
+CHUNK_ALIGN = 32
+# weight of a new measurement in the cost averages
+COST_EWMA = 0.2
+# latencies kept per class for the percentiles
+HISTORY = 1000
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(p / 100.0 * len(ordered)))]
+
+
+class CostModel:
+    """Measured per-token cost: prefill ms per token and decode step ms per batch size."""
+
+    def __init__(self):
+        self.prefill_ms_per_token = 0.0
+        self.step_ms = {}   # decode batch size -> ms per step
+
+    def observe_prefill(self, n_tokens, ms):
+        if n_tokens <= 0 or ms <= 0:
+            return
+        cost = ms / n_tokens
+        old = self.prefill_ms_per_token
+        self.prefill_ms_per_token = cost if old == 0 else (1 - COST_EWMA) * old + COST_EWMA * cost
+
+    def observe_decode(self, batch, ms_per_token):
+        if ms_per_token <= 0:
+            return
+        n = max(1, int(round(batch)))
+        old = self.step_ms.get(n)
+        self.step_ms[n] = ms_per_token if old is None else (1 - COST_EWMA) * old + COST_EWMA * ms_per_token
+
+    def step(self, n):
+        """Projected decode step time with n sequences in the batch."""
+        if n in self.step_ms:
+            return self.step_ms[n]
+        if not self.step_ms:
+            return 0.0
+        if len(self.step_ms) == 1:
+            # one measured batch size: each extra sequence adds one batched token
+            (n0, ms0), = self.step_ms.items()
+            return max(0.0, ms0 + (n - n0) * self.prefill_ms_per_token)
+        # least squares step = a + b * n over the measured batch sizes
+        xs = list(self.step_ms.keys())
+        ys = list(self.step_ms.values())
+        mx = sum(xs) / len(xs)
+        my = sum(ys) / len(ys)
+        var = sum((x - mx) ** 2 for x in xs)
+        b = sum((x - mx) * (y - my) for x, y in zip(xs, ys)) / var if var > 0 else 0.0
+        return max(0.0, my + max(0.0, b) * (n - mx))
+
+    def to_json(self):
+        return {"prefill_ms_per_token": round(self.prefill_ms_per_token, 4),
+                "decode_step_ms": {str(n): round(ms, 3) for n, ms in sorted(self.step_ms.items())}}
+
+
+class Request:
+    def __init__(self, cls_name, cls, n_prompt):
+        self.cls_name = cls_name
+        self.rank = cls["rank"]
+        self.ttft_ms = cls["ttft_ms"]
+        self.tpot_ms = cls["tpot_ms"]
+        self.n_prompt = n_prompt
+        self.arrival = time.perf_counter()
+        self.deadline = self.arrival + self.ttft_ms / 1000.0
+        self.slot = None
+        self.decoding = False
+        # decode batch size integrated over time from start_decode, for the cost model
+        self.batch_area = 0.0
+        self.batch_since = None
+        self.batch_n = 0
+        self.decode_since = None
+
+
+class ClassStats:
+    def __init__(self):
+        self.requests = 0
+        self.errors = 0
+        self.measured = 0
+        self.decoded = 0    # measured requests that generated a token, the TPOT sample
+        self.queued = 0
+        self.active = 0
+        self.ttft_met = 0
+        self.tpot_met = 0
+        self.forced = 0     # admitted past the TTFT deadline against the TPOT rule
+        self.ttft_ms = collections.deque(maxlen=HISTORY)
+        self.tpot_ms = collections.deque(maxlen=HISTORY)
+        self.queue_ms = collections.deque(maxlen=HISTORY)
+
+    def to_json(self):
+        done, decoded = self.measured, self.decoded
+        out = {"requests": self.requests, "errors": self.errors, "queued": self.queued, "active": self.active,
+               "forced_admissions": self.forced,
+               "ttft_attainment": round(self.ttft_met / done, 4) if done else None,
+               "tpot_attainment": round(self.tpot_met / decoded, 4) if decoded else None}
+        for name, values in (("ttft_ms", self.ttft_ms), ("tpot_ms", self.tpot_ms), ("queue_ms", self.queue_ms)):
+            out[name] = {f"p{p}": (round(percentile(values, p), 2) if values else None) for p in (50, 95, 99)}
+        return out
+
+
+class SloScheduler:
+    """Decides which queued requests take a slot and how large their prefill chunks are."""
+
+    def __init__(self, classes, n_slots, reserve, chunk_min):
+        self.classes = classes
+        self.n_slots = n_slots
+        self.top_rank = min(c["rank"] for c in classes.values())
+        # slots only the most important class may take
+        self.reserve = min(reserve, n_slots - 1)
+        self.chunk_min = chunk_min
+        self.cost = CostModel()
+        self.cond = threading.Condition()
+        self.queue = []
+        self.active = []
+        self.free_slots = list(range(n_slots))
+        self.stats = {name: ClassStats() for name in classes}
+
+    def class_of(self, name):
+        if name in self.classes:
+            return name
+        return DEFAULT_CLASS if DEFAULT_CLASS in self.classes else min(self.classes, key=lambda c: self.classes[c]["rank"])
+
+    # --- decode batch bookkeeping (under cond) ---
+
+    def _n_decoding(self):
+        return sum(1 for r in self.active if r.decoding)
+
+    def _batch_changed(self):
+        now = time.perf_counter()
+        n = self._n_decoding()
+        for r in self.active:
+            if r.decoding:
+                if r.batch_since is not None:
+                    r.batch_area += r.batch_n * (now - r.batch_since)
+                r.batch_since = now
+                r.batch_n = n
+
+    # --- admission ---
+
+    def _admissible(self, req, now):
+        if not self.free_slots:
+            return False
+        if req.rank != self.top_rank and len(self.free_slots) <= self.reserve:
+            return False
+        if not self.active or now >= req.deadline:
+            return True
+        tightest = min([r.tpot_ms for r in self.active] + [req.tpot_ms])
+        return self.cost.step(len(self.active) + 1) <= tightest
+
+    def _dispatch(self):
+        now = time.perf_counter()
+        self.queue.sort(key=lambda r: (r.rank, r.deadline))
+        # strict order: a looser request never overtakes one that is waiting for the batch to shrink
+        while self.queue and self._admissible(self.queue[0], now):
+            req = self.queue.pop(0)
+            if self.active and now >= req.deadline:
+                tightest = min([r.tpot_ms for r in self.active] + [req.tpot_ms])
+                if self.cost.step(len(self.active) + 1) > tightest:
+                    self.stats[req.cls_name].forced += 1
+            req.slot = self.free_slots.pop(0)
+            self.active.append(req)
+            st = self.stats[req.cls_name]
+            st.queued -= 1
+            st.active += 1
+            st.queue_ms.append((now - req.arrival) * 1000)
+        self.cond.notify_all()
+
+    def submit(self, cls_name, n_prompt):
+        """Queue a request and block until it holds a slot."""
+        req = Request(cls_name, self.classes[cls_name], n_prompt)
+        with self.cond:
+            self.stats[cls_name].requests += 1
+            self.stats[cls_name].queued += 1
+            self.queue.append(req)
+            self._dispatch()
+            while req.slot is None:
+                # wake at the TTFT deadline, when the request may be forced in
+                self.cond.wait(timeout=max(0.01, req.deadline - time.perf_counter()))
+                self._dispatch()
+        return req
+
+    # --- prefill chunks ---
+
+    def prefill_chunk(self, req, remaining):
+        """Tokens of the prompt to evaluate next without breaking the TPOT of more important decoders."""
+        with self.cond:
+            guarded = [r for r in self.active if r.decoding and r is not req and r.rank <= req.rank]
+            if not guarded or self.cost.prefill_ms_per_token <= 0:
+                return remaining
+            slack = min(r.tpot_ms for r in guarded) - self.cost.step(self._n_decoding())
+            tokens = int(slack / self.cost.prefill_ms_per_token) // CHUNK_ALIGN * CHUNK_ALIGN
+            return min(remaining, max(self.chunk_min, tokens))
+
+    def start_decode(self, req):
+        with self.cond:
+            req.decoding = True
+            self._batch_changed()
+            req.decode_since = req.batch_since
+
+    # --- completion ---
+
+    def finish(self, req, timings, wall_ms, error=False):
+        with self.cond:
+            was_decoding = req.decoding
+            decode_s = 0.0
+            if was_decoding:
+                self._batch_changed()
+                decode_s = req.batch_since - req.decode_since
+            req.decoding = False
+            self.active.remove(req)
+            self.free_slots.append(req.slot)
+            if was_decoding:
+                self._batch_changed()
+            st = self.stats[req.cls_name]
+            st.active -= 1
+            if error or timings is None:
+                st.errors += error
+                self._dispatch()
+                return
+            st.measured += 1
+
+            if timings.get("prompt_n", 0) > 0:
+                self.cost.observe_prefill(timings["prompt_n"], timings.get("prompt_ms", 0.0))
+            tpot = timings.get("predicted_per_token_ms", 0.0)
+            if timings.get("predicted_n", 0) > 1:
+                # mean batch over the integrated interval, which also covers the final prompt evaluation;
+                # predicted_ms leaves that out and would overstate the batch
+                batch = req.batch_area / decode_s if decode_s > 0 else 1.0
+                self.cost.observe_decode(max(1.0, batch), tpot)
+
+            # TTFT: everything before the final request, its prompt and one decode step
+            ttft = wall_ms - timings.get("predicted_ms", 0.0) + tpot
+            st.ttft_ms.append(ttft)
+            st.ttft_met += ttft <= req.ttft_ms
+            if timings.get("predicted_n", 0) > 0:
+                st.decoded += 1
+                st.tpot_ms.append(tpot)
+                st.tpot_met += tpot <= req.tpot_ms
+            self._dispatch()
+
+    def to_json(self):
+        with self.cond:
+            return {"slots": self.n_slots, "reserved_slots": self.reserve, "cost": self.cost.to_json(),
+                    "classes": {name: dict(self.classes[name], **st.to_json()) for name, st in self.stats.items()}}
+
+
+class SloServer:
+    """Routes /completion to llama-server through the scheduler."""
+
+    def __init__(self, backend, scheduler):
+        self.backend = backend
+        self.scheduler = scheduler
+
+    def calibrate(self, n_prompt=128, n_predict=16):
+        """Seed the cost model with one probe request."""
+        tokens = self.backend.post("/tokenize", {"content": "The quick brown fox jumps over the lazy dog. " * 16})["tokens"]
+        tokens = (tokens * (n_prompt // max(1, len(tokens)) + 1))[:n_prompt]
+        result = self.backend.post("/completion", {"prompt": tokens, "n_predict": n_predict, "cache_prompt": False,
+                                                   "temperature": 0})
+        timings = result.get("timings", {})
+        self.scheduler.cost.observe_prefill(timings.get("prompt_n", 0), timings.get("prompt_ms", 0.0))
+        self.scheduler.cost.observe_decode(1, timings.get("predicted_per_token_ms", 0.0))
+        logger.info(f"Cost model: {json.dumps(self.scheduler.cost.to_json())}")
+
+    def tokenize(self, prompt):
+        if isinstance(prompt, list) and all(isinstance(t, int) for t in prompt):
+            return prompt
+        if isinstance(prompt, str):
+            return self.backend.post("/tokenize", {"content": prompt, "add_special": True})["tokens"]
+        # several prompts or mixed content: llama-server handles it, unchunked
+        return None
+
+    def prefill(self, req, tokens):
+        """Evaluate the head of the prompt in chunks through the prompt cache."""
+        done = 0
+        target = len(tokens) - 1
+        while done < target:
+            chunk = self.scheduler.prefill_chunk(req, target - done)
+            if chunk >= target - done:
+                # the final request evaluates the rest
+                return
+            done += chunk
+            result = self.backend.post("/completion", {"prompt": tokens[:done], "n_predict": 0,
+                                                       "cache_prompt": True, "id_slot": req.slot})
+            timings = result.get("timings", {})
+            with self.scheduler.cond:
+                self.scheduler.cost.observe_prefill(timings.get("prompt_n", 0), timings.get("prompt_ms", 0.0))
+
+    def make_handler(self):
+        server = self
+
+        class Handler(BaseHTTPRequestHandler):
+            protocol_version = "HTTP/1.1"
+
+            def log_message(self, fmt, *args):
+                logger.debug(fmt % args)
+
+            def reply_raw(self, status, content_type, body):
+                self.send_response(status)
+                self.send_header("Content-Type", content_type)
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def reply_json(self, status, obj):
+                self.reply_raw(status, "application/json", json.dumps(obj).encode())
+
+            def reply_error(self, e, what):
+                """Pass a backend HTTP error on, report any other failure as 502."""
+                try:
+                    if self.started:
+                        # a reply is already on the wire, ending the chunked stream early is all that is left
+                        self.close_connection = True
+                    elif isinstance(e, urllib.error.HTTPError):
+                        self.reply_raw(e.code, e.headers.get("Content-Type", "application/json"), e.read())
+                    else:
+                        self.reply_json(502, {"error": f"{what} failed: {e}"})
+                except OSError:
+                    self.close_connection = True
+
+            def do_GET(self):
+                if self.path == "/health":
+                    self.reply_json(200, {"status": "ok"})
+                elif self.path == "/stats":
+                    self.reply_json(200, server.scheduler.to_json())
+                else:
+                    self.reply_json(404, {"error": "not found"})
+
+            def forward(self, req, payload):
+                """Proxy the final request; returns its timings."""
+                timings = None
+                with server.backend.request("/completion", payload) as resp:
+                    if not payload.get("stream"):
+                        body = resp.read()
+                        timings = json.loads(body or b"{}").get("timings")
+                        self.started = True
+                        self.send_response(resp.status)
+                        self.send_header("Content-Type", resp.headers.get("Content-Type", "application/json"))
+                        self.send_header("Content-Length", str(len(body)))
+                        self.end_headers()
+                        self.wfile.write(body)
+                        return timings
+                    self.started = True
+                    self.send_response(resp.status)
+                    self.send_header("Content-Type", resp.headers.get("Content-Type", "text/event-stream"))
+                    self.send_header("Transfer-Encoding", "chunked")
+                    self.end_headers()
+                    pending = b""
+                    while True:
+                        chunk = resp.read1(65536) if hasattr(resp, "read1") else resp.read(65536)
+                        if not chunk:
+                            break
+                        self.wfile.write(b"%x\r\n%s\r\n" % (len(chunk), chunk))
+                        self.wfile.flush()
+                        # the last event carries the timings
+                        pending += chunk
+                        *lines, pending = pending.split(b"\n")
+                        for line in lines:
+                            if line.startswith(b"data: ") and b'"timings"' in line:
+                                try:
+                                    timings = json.loads(line[6:]).get("timings")
+                                except json.JSONDecodeError:
+                                    pass
+                    if resp.length:
+                        # read1 reports a body cut short of its Content-Length as a plain end of stream
+                        raise http.client.IncompleteRead(b"", resp.length)
+                    self.wfile.write(b"0\r\n\r\n")
+                return timings
+
+            def do_POST(self):
+                if self.path not in ("/completion", "/completions"):
+                    self.reply_json(404, {"error": "only /completion is routed by the SLO scheduler"})
+                    return
+                payload = json.loads(self.rfile.read(int(self.headers.get("Content-Length", 0))) or b"{}")
+                self.started = False
+                cls_name = server.scheduler.class_of(payload.pop("priority", None) or self.headers.get("X-Priority"))
+                try:
+                    tokens = server.tokenize(payload.get("prompt", ""))
+                except Exception as e:
+                    self.reply_error(e, "tokenize")
+                    return
+
+                req = server.scheduler.submit(cls_name, len(tokens) if tokens else 0)
+                t0 = time.perf_counter()
+                timings = None
+                try:
+                    if tokens:
+                        server.prefill(req, tokens)
+                        payload["prompt"] = tokens
+                    server.scheduler.start_decode(req)
+                    payload.update({"cache_prompt": True, "id_slot": req.slot})
+                    timings = self.forward(req, payload)
+                except Exception as e:
+                    # a request the backend rejects (4xx) is the client's error, not the deployment's
+                    server.scheduler.finish(req, None, 0.0,
+                                            error=not isinstance(e, urllib.error.HTTPError) or e.code >= 500)
+                    self.reply_error(e, "completion")
+                    return
+                wall_ms = (time.perf_counter() - req.arrival) * 1000
+                logger.debug(f"{cls_name} request: {wall_ms:.0f} ms, {(time.perf_counter() - t0) * 1000:.0f} ms in a slot")
+                server.scheduler.finish(req, timings, wall_ms)
+
+        return Handler
+
+    def serve(self, host, port):
+        httpd = ThreadingHTTPServer((host, port), self.make_handler())
+        logger.info(f"SLO scheduler listening on {host}:{port}")
+        try:
+            httpd.serve_forever()
+        finally:
+            httpd.server_close()
+
+
+def load_classes(path):
+    if not path:
+        return DEFAULT_CLASSES
+    with open(path) as f:
+        classes = json.load(f)
+    for name, cls in classes.items():
+        for key in ("rank", "ttft_ms", "tpot_ms"):
+            if key not in cls:
+                raise ValueError(f"priority class {name} has no {key}")
+    return classes
+
+
+def run_slo(args, server_path):
+    """Entry point used by run_inference_server.py --slo."""
+    logging.basicConfig(level=logging.INFO)
+
+    classes = load_classes(args.slo_classes)
+    if args.slot_save_path:
+        os.makedirs(args.slot_save_path, exist_ok=True)
+    backend = ServerPool(
+        "slo", server_path, args.model, [], args.threads, args.slots, args.ctx_size,
+        args.prefill_batch_size, args.prefill_batch_size, args.port + 1, args.slot_save_path,
+        ['-n', str(args.n_predict), '--temp', str(args.temperature)])
+    scheduler = SloScheduler(classes, args.slots, args.slo_reserve, args.prefill_chunk_min)
+    try:
+        backend.start()
+        backend.wait_ready()
+        server = SloServer(backend, scheduler)
+        server.calibrate()
+        server.serve(args.host, args.port)
+    finally:
+        backend.stop()